@@ -0,0 +1,187 @@
+/*
+ Copyright (C) 2017 Timofey Tavlintsev [http://tvl.io]
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+
+/// Headless benchmarks, run all or the ones given by name: import, load, gather
+
+#include "ofMain.h"
+#include "grab/ofxLedGrabPixelMapLoad.h"
+#include "ofxLedController.h"
+#include "ofxLedLayout.h"
+
+using namespace LedMapper;
+
+static const size_t s_pixelMapPoints = 500000;
+static const size_t s_configGrabs = 100000;
+static const int s_gatherStep = 4; /// pixels between LEDs of 4K matrix
+
+/// best of runs in ms
+static float measure(size_t runs, const function<void()> &fnc)
+{
+    uint64_t best = numeric_limits<uint64_t>::max();
+    for (size_t i = 0; i < runs; ++i) {
+        auto startTime = ofGetElapsedTimeMicros();
+        fnc();
+        best = std::min(best, ofGetElapsedTimeMicros() - startTime);
+    }
+    return best / 1000.f;
+}
+
+/// 500k points as CSV and binary, streamed straight to sink and collected into descriptions
+static void benchImport()
+{
+    auto csvPath = ofToDataPath("bench/pixelmap.csv", true);
+    auto binPath = ofToDataPath("bench/pixelmap.bin", true);
+    {
+        ofstream csv(csvPath);
+        ofstream bin(binPath, ios::binary);
+        csv << "x,y\n";
+        for (size_t i = 0; i < s_pixelMapPoints; ++i) {
+            float point[2] = { ofRandom(3840), ofRandom(2160) };
+            csv << point[0] << ',' << point[1] << '\n';
+            bin.write(reinterpret_cast<const char *>(point), sizeof(point));
+        }
+    }
+
+    for (const auto &path : { csvPath, binPath }) {
+        size_t points = 0;
+        float streamTime = measure(5, [&] {
+            points = 0;
+            ParsePixelMapToGrabDescs(path, 1024, numeric_limits<size_t>::max(),
+                                     [&points](LedGrabDesc &&desc) {
+                                         points += desc.points.size();
+                                         return true;
+                                     });
+        });
+        vector<LedGrabDesc> descs;
+        float collectTime = measure(5, [&] {
+            ParsePixelMapToGrabDescs(path, 1024, numeric_limits<size_t>::max(), descs);
+        });
+        ofLogNotice("bench") << "import " << ofFilePath::getFileName(path) << ": " << points
+                             << " points, stream " << streamTime << "ms, collect " << collectTime
+                             << "ms into " << descs.size() << " channels";
+    }
+}
+
+/// controller config with 100k lines, circles and matrices, loaded through json DOM
+/// as before and through streaming reader of ofxLedController::ReadConfig
+static void benchLoad()
+{
+    auto folder = ofToDataPath("bench/", true);
+    {
+        ofxLedGrabPool pool;
+        ofJson grabs = ofJson::array();
+        for (size_t i = 0; i < s_configGrabs; ++i) {
+            ofVec2f from(ofRandom(3000), ofRandom(2000));
+            auto type = static_cast<LMGrabType>(1 + i % 3);
+            auto handle = pool.create(type);
+            auto grab = pool[handle];
+            grab->setChannel(i % 2);
+            grab->set(from, type == LMGrabType::GRAB_LINE
+                                ? from + ofVec2f(ofRandom(300), ofRandom(300))
+                                : from + ofVec2f(20, 20));
+            grabs.push_back(grab->toJson());
+            pool.destroy(handle);
+        }
+        ofJson config = { { "pixInLed", 4.f }, { "grabs", move(grabs) } };
+        ofSaveJson(folder + LCFileName + "0.json", config);
+    }
+
+    size_t grabs = 0;
+    float domTime = measure(3, [&] {
+        ofxLedGrabPool pool;
+        auto json = ofLoadJson(folder + LCFileName + "0.json");
+        auto pixelsInLed = json.at("pixInLed").get<float>();
+        pool.reserve(json.at("grabs").size());
+        for (const auto &jsonGrab : json.at("grabs")) {
+            auto handle = pool.createFromJson(jsonGrab);
+            if (handle.isValid())
+                pool[handle]->setPixelsInLed(pixelsInLed);
+        }
+        grabs = pool.size();
+    });
+    float streamTime = measure(3, [&] {
+        auto config = ofxLedController::ReadConfig(0, LedOutputTypeLedmap, folder);
+        grabs = config.grabPool.size();
+    });
+    ofLogNotice("bench") << "load " << grabs << " grabs: json dom " << domTime << "ms, stream "
+                         << streamTime << "ms";
+}
+
+/// 4K frame sampled by vertical zig-zag matrix columns interleaved over 8 channels,
+/// wiring order gather against Morton ordered sample table
+static void benchGather()
+{
+    ofPixels pixels;
+    pixels.allocate(3840, 2160, 4);
+    for (size_t i = 0; i < pixels.size(); ++i)
+        pixels.getData()[i] = i * 31;
+
+    const size_t numChannels = 8;
+    const int columns = pixels.getWidth() / s_gatherStep;
+    const int rows = pixels.getHeight() / s_gatherStep;
+    vector<vector<glm::vec3>> channels(numChannels);
+    for (int col = 0; col < columns; ++col) {
+        for (int row = 0; row < rows; ++row) {
+            int y = col % 2 ? rows - 1 - row : row;
+            channels[col % numChannels].emplace_back((col + 0.5f) * s_gatherStep,
+                                                     (y + 0.5f) * s_gatherStep, 0);
+        }
+    }
+
+    /// channel LED counts are 16 bit, one total is enough for gather
+    LedLayout layout;
+    for (const auto &channel : channels)
+        layout.points.insert(layout.points.end(), channel.begin(), channel.end());
+    layout.totalLeds = layout.points.size();
+    layout.channelsTotalLeds.assign(1, 0);
+
+    vector<char> leds;
+    auto gather = [&] { GatherLayoutPixels(layout, pixels, GRB, leds); };
+    float wiringTime = measure(30, gather);
+    auto wiringLeds = leds;
+
+    auto startTime = ofGetElapsedTimeMicros();
+    CompileLayoutSamples(layout);
+    float compileTime = (ofGetElapsedTimeMicros() - startTime) / 1000.f;
+    float mortonTime = measure(30, gather);
+
+    ofLogNotice("bench") << "gather " << layout.totalLeds << " leds: wiring order " << wiringTime
+                         << "ms, morton order " << mortonTime << "ms, compile " << compileTime
+                         << "ms, " << (leds == wiringLeds ? "same" : "DIFFERENT") << " output";
+}
+
+int main(int argc, char *argv[])
+{
+    ofDirectory::createDirectory(ofToDataPath("bench/", true), false, true);
+    ofSetLogLevel(OF_LOG_WARNING);
+    ofSetLogLevel("bench", OF_LOG_NOTICE);
+
+    const map<string, function<void()>> benches
+        = { { "import", benchImport }, { "load", benchLoad }, { "gather", benchGather } };
+    for (const auto &bench : benches) {
+        if (argc > 1 && find(argv + 1, argv + argc, bench.first) == argv + argc)
+            continue;
+        bench.second();
+    }
+    return 0;
+}
@@ -0,0 +1,95 @@
+/*
+ Copyright (C) 2017 Timofey Tavlintsev [http://tvl.io]
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+
+/// Headless checks of controller edit history, exit code is number of failed checks
+
+#include "ofMain.h"
+#include "ofxLedController.h"
+
+using namespace LedMapper;
+
+static int s_failed = 0;
+
+static void check(bool condition, const string &name)
+{
+    ofLog(condition ? OF_LOG_NOTICE : OF_LOG_ERROR) << (condition ? "ok   " : "FAIL ") << name;
+    if (!condition)
+        ++s_failed;
+}
+
+static ofMouseEventArgs mouseAt(float x, float y)
+{
+    ofMouseEventArgs args;
+    args.x = x;
+    args.y = y;
+    return args;
+}
+
+static vector<glm::vec3> layoutPoints(const ofxLedController &ctrl)
+{
+    return ctrl.peekLayout()->points;
+}
+
+/// points grab keeps its points through delete, drag and undo
+static void checkPointsUndo()
+{
+    ofxLedController ctrl(0, LedOutputTypeLedmap, ofToDataPath("check/"));
+    ctrl.setSelected(true);
+
+    LedGrabDesc desc;
+    desc.type = LMGrabType::GRAB_POINTS;
+    for (int i = 0; i < 100; ++i)
+        desc.points.emplace_back(10 + i, 20 + i % 5);
+    check(ctrl.addGrabs({ desc }), "points grab added");
+    ctrl.updateGrabPoints();
+    auto points = layoutPoints(ctrl);
+    check(points.size() == desc.points.size(), "points grab leds");
+
+    ctrl.setGrabsSelected(true);
+    ctrl.deleteSelectedGrabs();
+    ctrl.updateGrabPoints();
+    check(ctrl.getTotalLeds() == 0, "points grab deleted");
+
+    ctrl.undo();
+    ctrl.updateGrabPoints();
+    check(layoutPoints(ctrl) == points, "points restored by undo of delete");
+
+    ctrl.setGrabsSelected(true);
+    auto from = mouseAt(desc.points[0].x, desc.points[0].y);
+    auto to = mouseAt(from.x + 10, from.y + 10);
+    ctrl.mousePressed(from);
+    ctrl.mouseDragged(to);
+    ctrl.mouseReleased(to);
+    ctrl.updateGrabPoints();
+    check(layoutPoints(ctrl) != points, "points grab dragged");
+
+    ctrl.undo();
+    ctrl.updateGrabPoints();
+    check(layoutPoints(ctrl) == points, "points restored by undo of drag");
+}
+
+int main()
+{
+    checkPointsUndo();
+    return s_failed;
+}
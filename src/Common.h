@@ -42,6 +42,9 @@ static const string LMGUIButtonLoad = "Load";
 static const string LMGUISliderFadeTime = "Fade(sec)";
 static const string LMGUIListPlaylist = "Playlist";
 static const string LMGUIListPlaylistDelete = "Delete item";
+static const string LMGUIButtonNextCue = "Next cue";
+static const string LMGUIToggleRecord = "Record";
+static const string LMGUITogglePlayback = "Play capture";
 
 static const string LMGUIMouseSelect = "Select";
 static const string LMGUIMouseGrabLine = "Line";
@@ -59,10 +62,40 @@ static const string LCGUIDropChannelNum = "Channel";
 static const string LCGUIButtonDmx = "DMX";
 static const string LCGUISliderUniInChan = "Uni in chan";
 static const string LCGUIStartUni = "Start Uni";
+static const string LCGUISliderGamma = "Gamma";
+static const string LCGUISliderBrightness = "Brightness";
+static const string LCGUISliderWhiteR = "White R";
+static const string LCGUISliderWhiteG = "White G";
+static const string LCGUISliderWhiteB = "White B";
+static const string LCGUIToggleDither = "Dithering";
+static const string LCGUIDropInterpolation = "Interpolation";
+static const string LCGUIDropSmoothing = "Smoothing";
+static const string LCGUISliderSmoothTime = "Smooth(ms)";
+static const string LCGUISliderSlewRate = "Slew(lvl/sec)";
+static const string LCGUITextSource = "Source";
+static const string LCGUIDropMergeMode = "Merge";
+static const string LCGUISliderChannelAmps = "Chan limit(A)";
+static const string LCGUISliderControllerAmps = "Ctrl limit(A)";
 static const string LCFileName = "Ctrl-";
 
 #endif
 
+#ifdef WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/// compiled layout of all controllers, see ofxLedLayoutBin
+static const string LMLayoutBinFileName = "layout.lmbin";
+/// cue list of mapper, see ofxLedPlaylist
+static const string LMPlaylistFileName = "playlist.json";
+/// recorded output of controller N is Capture-N.lmrec in capture folder
+static const string LMCaptureFolder = "capture";
+static const string LMCaptureFileName = "Capture-";
+static const string LMCaptureFileExt = ".lmrec";
+
 /// Config for Rpi
 static const string LMCtrlsFolderPath = "Ctrls";
 static const string RPI_IP = "192.168.2.102";
@@ -142,6 +175,52 @@ static bool IsBroadcastIp(const string &ip)
 static bool IsNumber(const string &str){
     return str.find_first_not_of("0123456789") == string::npos;
 }
+
+/// Push written file from OS cache to disk
+static bool SyncFile(const string &path)
+{
+#ifdef WIN32
+    int fd = _open(path.c_str(), _O_WRONLY | _O_BINARY);
+    if (fd < 0)
+        return false;
+    bool result = _commit(fd) == 0;
+    _close(fd);
+#else
+    int fd = ::open(path.c_str(), O_WRONLY);
+    if (fd < 0)
+        return false;
+    bool result = ::fsync(fd) == 0;
+    ::close(fd);
+#endif
+    return result;
+}
+
+/// Write to temporary file and rename it over path, so crash never leaves half written file.
+/// Temporary file is synced before rename, otherwise power loss may leave renamed empty file
+static bool WriteFileAtomic(const string &path, const function<bool(ostream &)> &write)
+{
+    auto filePath = ofToDataPath(path);
+    auto tmpPath = filePath + ".tmp";
+    std::error_code err;
+    {
+        ofstream file(tmpPath, ios::binary | ios::trunc);
+        if (!file.is_open() || !write(file) || !file.flush()) {
+            file.close();
+            std::filesystem::remove(tmpPath, err);
+            return false;
+        }
+    }
+    if (!SyncFile(tmpPath)) {
+        std::filesystem::remove(tmpPath, err);
+        return false;
+    }
+    std::filesystem::rename(tmpPath, filePath, err);
+    if (err) {
+        std::filesystem::remove(tmpPath, err);
+        return false;
+    }
+    return true;
+}
     
 /// COLORS
 static const int LM_COLOR_GREEN = 0x009688;
@@ -165,6 +244,26 @@ static GRAB_COLOR_TYPE GetColorType(const string &name)
                : GRAB_COLOR_TYPE::RGB;
 }
 
+/// source channel for each output byte
+static std::array<int, 3> GetColorOrder(GRAB_COLOR_TYPE type)
+{
+    switch (type) {
+        case BRG:
+            return { 2, 0, 1 };
+        case BGR:
+            return { 2, 1, 0 };
+        case GRB:
+            return { 1, 0, 2 };
+        case GBR:
+            return { 1, 2, 0 };
+        case RBG:
+            return { 0, 2, 1 };
+        case RGB:
+        default:
+            return { 0, 1, 2 };
+    }
+}
+
 /// CONSTANTS
 static const int POINT_RAD = 4;
 static const int MAX_PIX_IN_CTRL = 4000;
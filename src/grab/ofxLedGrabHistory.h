@@ -0,0 +1,153 @@
+/*
+ Copyright (C) 2017 Timofey Tavlintsev [http://tvl.io]
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+
+#pragma once
+
+#include "ofxLedGrabObject.h"
+#include <deque>
+
+namespace LedMapper {
+
+/// default memory cap of undo history per controller
+static const size_t s_defaultHistoryMemoryLimit = 32 * 1024 * 1024; /// in bytes
+
+/// One change of grabs in channel: grabs [position, position + removed.size()) were replaced
+/// by inserted. Only touched grabs are stored, so record costs O(changed grabs)
+struct LedGrabEdit {
+    size_t channel = 0;
+    size_t position = 0;
+    vector<LedGrabDesc> removed;
+    vector<LedGrabDesc> inserted;
+};
+
+/// Edits of one user action, applied in order and reverted in reverse order
+using LedGrabEdits = vector<LedGrabEdit>;
+
+/// Undo / redo log of grab edits.
+/// History doesn't touch grabs itself, controller applies returned edits to its pool,
+/// oldest actions are dropped when log grows over memory limit
+class ofxLedGrabHistory {
+public:
+    /// record already applied action, drops redo tail
+    void push(LedGrabEdits &&edits)
+    {
+        if (edits.empty())
+            return;
+
+        while (m_entries.size() > m_applied)
+            popBack();
+
+        Entry entry{ move(edits), 0 };
+        entry.bytes = EstimateBytes(entry.edits);
+        m_bytes += entry.bytes;
+        m_entries.emplace_back(move(entry));
+        ++m_applied;
+        trim();
+    }
+
+    /// returns edits to revert or nullptr when nothing to undo
+    const LedGrabEdits *undo()
+    {
+        if (!canUndo())
+            return nullptr;
+        return &m_entries[--m_applied].edits;
+    }
+
+    /// returns edits to apply again or nullptr when nothing to redo
+    const LedGrabEdits *redo()
+    {
+        if (!canRedo())
+            return nullptr;
+        return &m_entries[m_applied++].edits;
+    }
+
+    bool canUndo() const { return m_applied > 0; }
+    bool canRedo() const { return m_applied < m_entries.size(); }
+
+    void clear()
+    {
+        m_entries.clear();
+        m_applied = 0;
+        m_bytes = 0;
+    }
+
+    void setMemoryLimit(size_t bytes)
+    {
+        m_memoryLimit = bytes;
+        trim();
+    }
+    size_t getMemoryLimit() const { return m_memoryLimit; }
+    size_t getMemoryUsage() const { return m_bytes; }
+    size_t size() const { return m_entries.size(); }
+
+private:
+    struct Entry {
+        LedGrabEdits edits;
+        size_t bytes;
+    };
+
+    static size_t EstimateBytes(const vector<LedGrabDesc> &descs)
+    {
+        size_t bytes = descs.capacity() * sizeof(LedGrabDesc);
+        for (const auto &desc : descs)
+            bytes += desc.points.capacity() * sizeof(ofVec2f);
+        return bytes;
+    }
+
+    static size_t EstimateBytes(const LedGrabEdits &edits)
+    {
+        size_t bytes = sizeof(Entry) + edits.capacity() * sizeof(LedGrabEdit);
+        for (const auto &edit : edits)
+            bytes += EstimateBytes(edit.removed) + EstimateBytes(edit.inserted);
+        return bytes;
+    }
+
+    void popBack()
+    {
+        m_bytes -= m_entries.back().bytes;
+        m_entries.pop_back();
+    }
+
+    /// drop oldest undo steps first, then redo steps, one entry is always kept
+    void trim()
+    {
+        while (m_bytes > m_memoryLimit && m_entries.size() > 1) {
+            if (m_applied > 0) {
+                m_bytes -= m_entries.front().bytes;
+                m_entries.pop_front();
+                --m_applied;
+            }
+            else {
+                popBack();
+            }
+        }
+    }
+
+    std::deque<Entry> m_entries;
+    /// number of entries from front that are applied to layout
+    size_t m_applied = 0;
+    size_t m_bytes = 0;
+    size_t m_memoryLimit = s_defaultHistoryMemoryLimit;
+};
+
+} // namespace LedMapper
@@ -0,0 +1,300 @@
+/*
+ Copyright (C) 2017 Timofey Tavlintsev [http://tvl.io]
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+
+#pragma once
+
+#include "Common.h"
+#include "grab/ofxLedGrabPool.h"
+#include "ofMain.h"
+
+namespace LedMapper {
+
+/// Streaming load of Ctrl-N.json.
+/// Grabs are read straight from parser events into LedGrabDesc without building json DOM
+/// for "grabs" array, all other top level keys are collected to settings json.
+/// Missing or wrongly typed grab fields get same defaults as ofxLedGrab::fromJson.
+
+class GrabJsonSax {
+public:
+    GrabJsonSax(ofJson &settings, vector<LedGrabDesc> &descs)
+        : m_settings(settings)
+        , m_descs(descs)
+    {
+    }
+
+    bool null() { return value(nullptr); }
+    bool boolean(bool val) { return value(val); }
+    bool number_integer(ofJson::number_integer_t val) { return value(val); }
+    bool number_unsigned(ofJson::number_unsigned_t val) { return value(val); }
+    bool number_float(ofJson::number_float_t val, const ofJson::string_t &) { return value(val); }
+    bool string(ofJson::string_t &val) { return value(val); }
+    template <typename Binary>
+    bool binary(Binary &)
+    {
+        return true;
+    }
+
+    bool start_object(size_t)
+    {
+        ++m_depth;
+        if (m_inGrabs) {
+            if (m_depth == s_grabDepth)
+                startGrab();
+            else if (m_depth == s_grabDepth + 1 && m_key == "colorCorrection")
+                m_inCorrection = m_desc.hasColorCorrection = true;
+            return true;
+        }
+        return startContainer(ofJson::object());
+    }
+
+    bool key(ofJson::string_t &val)
+    {
+        m_key = val;
+        return true;
+    }
+
+    bool end_object()
+    {
+        if (m_inGrabs) {
+            if (m_depth == s_grabDepth)
+                endGrab();
+            else if (m_depth == s_grabDepth + 1)
+                m_inCorrection = false;
+            --m_depth;
+            return true;
+        }
+        --m_depth;
+        m_stack.pop_back();
+        return true;
+    }
+
+    bool start_array(size_t)
+    {
+        ++m_depth;
+        if (m_inGrabs) {
+            m_coords = nullptr;
+            if (m_depth == s_grabDepth + 1 && m_key == "points")
+                m_coords = &m_points;
+            else if (m_depth == s_grabDepth + 1 && m_key == "controlPoints")
+                m_coords = &m_controlPoints;
+            else if (m_depth == s_grabDepth + 2 && m_inCorrection && m_key == "whiteBalance")
+                m_coords = &m_whiteBalance;
+            return true;
+        }
+        if (m_depth == s_grabDepth - 1 && m_key == "grabs") {
+            m_inGrabs = true;
+            return true;
+        }
+        return startContainer(ofJson::array());
+    }
+
+    bool end_array()
+    {
+        if (m_inGrabs) {
+            m_coords = nullptr;
+            if (m_depth == s_grabDepth - 1)
+                m_inGrabs = false;
+            --m_depth;
+            return true;
+        }
+        --m_depth;
+        m_stack.pop_back();
+        return true;
+    }
+
+    bool parse_error(size_t position, const std::string &, const std::exception &ex)
+    {
+        ofLogError() << "[GrabJsonSax] Parse json failed at " << position << " with:" << ex.what();
+        return false;
+    }
+
+private:
+    /// root object -> "grabs" array -> grab object
+    static constexpr int s_grabDepth = 3;
+
+    bool startContainer(ofJson &&container)
+    {
+        if (m_stack.empty()) {
+            m_settings = move(container);
+            m_stack.push_back(&m_settings);
+            return true;
+        }
+        m_stack.push_back(&insert(move(container)));
+        return true;
+    }
+
+    ofJson &insert(ofJson &&val)
+    {
+        auto &parent = *m_stack.back();
+        if (parent.is_array()) {
+            parent.push_back(move(val));
+            return parent.back();
+        }
+        return parent[m_key] = move(val);
+    }
+
+    template <typename T>
+    bool value(T &&val)
+    {
+        if (!m_inGrabs) {
+            if (m_stack.empty())
+                m_settings = std::forward<T>(val);
+            else
+                insert(std::forward<T>(val));
+            return true;
+        }
+        if (m_depth == s_grabDepth + 1 && m_coords != nullptr)
+            readNumber(val, *m_coords);
+        else if (m_depth == s_grabDepth + 2 && m_coords == &m_whiteBalance)
+            readNumber(val, *m_coords);
+        else if (m_depth == s_grabDepth)
+            readField(val);
+        else if (m_depth == s_grabDepth + 1 && m_inCorrection)
+            readCorrectionField(val);
+        return true;
+    }
+
+    template <typename T>
+    static bool readNumber(const T &val, float &out)
+    {
+        if constexpr (std::is_arithmetic<T>::value && !std::is_same<T, bool>::value) {
+            out = static_cast<float>(val);
+            return true;
+        }
+        return false;
+    }
+    template <typename T>
+    static void readNumber(const T &val, vector<float> &out)
+    {
+        float number;
+        if (readNumber(val, number))
+            out.push_back(number);
+    }
+    template <typename T>
+    static void readBool(const T &val, bool &out)
+    {
+        if constexpr (std::is_same<T, bool>::value)
+            out = val;
+    }
+
+    template <typename T>
+    void readField(const T &val)
+    {
+        float number = 0.f;
+        if (m_key == "type") {
+            m_hasType = readNumber(val, number);
+            m_desc.type = static_cast<LMGrabType>(static_cast<int>(number));
+        }
+        else if (m_key == "channel" && readNumber(val, number))
+            m_desc.channel = static_cast<int>(number);
+        else if (m_key == "fromX")
+            readNumber(val, m_desc.from.x);
+        else if (m_key == "fromY")
+            readNumber(val, m_desc.from.y);
+        else if (m_key == "toX")
+            readNumber(val, m_desc.to.x);
+        else if (m_key == "toY")
+            readNumber(val, m_desc.to.y);
+        else if (m_key == "startAngle")
+            readNumber(val, m_desc.startAngle);
+        else if (m_key == "isDouble")
+            readBool(val, m_desc.isDouble);
+        else if (m_key == "isClockwise")
+            readBool(val, m_desc.isClockwise);
+        else if (m_key == "isVertical")
+            readBool(val, m_desc.isVertical);
+        else if (m_key == "isZigzag")
+            readBool(val, m_desc.isZigzag);
+        else if (m_key == "isBezier")
+            readBool(val, m_desc.isBezier);
+    }
+
+    /// same defaults as LedColorCorrection::fromJson
+    template <typename T>
+    void readCorrectionField(const T &val)
+    {
+        if (m_key == "gamma")
+            readNumber(val, m_desc.colorCorrection.gamma);
+        else if (m_key == "brightness")
+            readNumber(val, m_desc.colorCorrection.brightness);
+    }
+
+    void startGrab()
+    {
+        m_desc = LedGrabDesc();
+        /// ofxLedGrabCircle::fromJson default
+        m_desc.startAngle = 0.f;
+        m_hasType = false;
+        m_points.clear();
+        m_controlPoints.clear();
+        m_whiteBalance.clear();
+        m_inCorrection = false;
+    }
+
+    void endGrab()
+    {
+        if (!m_hasType)
+            return;
+        const auto &coords = m_desc.type == LMGrabType::GRAB_PATH ? m_controlPoints : m_points;
+        m_desc.points.reserve(coords.size() / 2);
+        for (size_t i = 0; i + 1 < coords.size(); i += 2)
+            m_desc.points.emplace_back(coords[i], coords[i + 1]);
+        if (m_whiteBalance.size() == 3)
+            std::copy(m_whiteBalance.begin(), m_whiteBalance.end(),
+                      m_desc.colorCorrection.whiteBalance.begin());
+        m_descs.emplace_back(move(m_desc));
+    }
+
+    ofJson &m_settings;
+    vector<LedGrabDesc> &m_descs;
+
+    vector<ofJson *> m_stack;
+    std::string m_key;
+    int m_depth = 0;
+    bool m_inGrabs = false;
+
+    LedGrabDesc m_desc;
+    bool m_hasType = false, m_inCorrection = false;
+    vector<float> m_points, m_controlPoints, m_whiteBalance;
+    vector<float> *m_coords = nullptr;
+};
+
+/// Read controller json, settings get every key except "grabs", grabs are appended to descs.
+/// Returns false when file can't be opened or parsed, outputs are cleared then
+static bool ParseJsonToGrabDescs(const string &path, ofJson &settings, vector<LedGrabDesc> &descs)
+{
+    ifstream file(ofToDataPath(path), ios::binary);
+    if (!file.is_open())
+        return false;
+
+    GrabJsonSax sax(settings, descs);
+    if (!ofJson::sax_parse(file, &sax)) {
+        ofLogError() << "[ofxLedGrabJsonLoad] Can't parse json=" << path;
+        settings = ofJson();
+        descs.clear();
+        return false;
+    }
+    return true;
+}
+
+} // namespace LedMapper
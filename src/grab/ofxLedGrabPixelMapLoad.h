@@ -0,0 +1,202 @@
+/*
+ Copyright (C) 2017 Timofey Tavlintsev [http://tvl.io]
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+#pragma once
+
+#include "Common.h"
+#include "grab/ofxLedGrabPool.h"
+#include "ofMain.h"
+
+namespace LedMapper {
+
+/// Pixel map import.
+/// CSV / TXT: one LED per line "x,y", separators , ; tab or space, extra columns ignored,
+/// lines that don't start with number (headers, # comments) skipped.
+/// Any other extension: raw little-endian float32 x,y pairs.
+/// File is streamed in fixed chunks and points go straight to sink without intermediate json.
+
+static const size_t s_pixelMapChunkSize = 1 << 20; /// in bytes
+
+/// sink returns false to stop reading
+using PixelMapSink = function<bool(const ofVec2f *points, size_t size)>;
+
+static bool IsPixelMapCsv(const string &path)
+{
+    auto ext = ofToLower(ofFilePath::getFileExt(path));
+    return ext == "csv" || ext == "txt";
+}
+
+/// parse "x,y..." line, returns false for headers and empty lines
+static bool ParsePixelMapLine(const char *begin, const char *end, ofVec2f &point)
+{
+    auto isSeparator = [](char c) { return c == ',' || c == ';' || c == ' ' || c == '\t'; };
+    while (begin != end && isSeparator(*begin))
+        ++begin;
+    if (begin == end || !(isdigit(*begin) || *begin == '-' || *begin == '.' || *begin == '+'))
+        return false;
+
+    char *next = nullptr;
+    point.x = strtof(begin, &next);
+    if (next == begin || next >= end)
+        return false;
+    begin = next;
+    while (begin != end && isSeparator(*begin))
+        ++begin;
+    if (begin == end)
+        return false;
+    point.y = strtof(begin, &next);
+    return next != begin;
+}
+
+static bool ReadPixelMapCsv(ifstream &file, const PixelMapSink &sink)
+{
+    vector<char> buffer(s_pixelMapChunkSize + 1);
+    vector<ofVec2f> points;
+    points.reserve(s_pixelMapChunkSize / 8);
+    size_t carry = 0;
+
+    while (file) {
+        file.read(buffer.data() + carry, s_pixelMapChunkSize - carry);
+        size_t size = carry + file.gcount();
+        if (size == 0)
+            break;
+        /// terminate last line of file
+        if (!file && buffer[size - 1] != '\n')
+            buffer[size++] = '\n';
+
+        const char *lineBegin = buffer.data();
+        const char *chunkEnd = buffer.data() + size;
+        ofVec2f point;
+        for (const char *it = lineBegin; it != chunkEnd; ++it) {
+            if (*it != '\n')
+                continue;
+            if (ParsePixelMapLine(lineBegin, it, point))
+                points.push_back(point);
+            lineBegin = it + 1;
+        }
+
+        if (!points.empty() && !sink(points.data(), points.size()))
+            return false;
+        points.clear();
+
+        /// move unfinished line to the start of buffer
+        carry = chunkEnd - lineBegin;
+        if (carry == s_pixelMapChunkSize) {
+            ofLogError() << "[ofxLedGrabPixelMapLoad] Line is longer than chunk";
+            return false;
+        }
+        std::memmove(buffer.data(), lineBegin, carry);
+    }
+    return true;
+}
+
+static bool ReadPixelMapBinary(ifstream &file, const PixelMapSink &sink)
+{
+    static_assert(sizeof(float) == 4, "Binary pixel map expects 32 bit floats");
+    vector<float> buffer(s_pixelMapChunkSize / sizeof(float));
+    vector<ofVec2f> points;
+    points.reserve(buffer.size() / 2);
+
+    while (file) {
+        file.read(reinterpret_cast<char *>(buffer.data()), buffer.size() * sizeof(float));
+        size_t floats = file.gcount() / sizeof(float);
+        for (size_t i = 0; i + 1 < floats; i += 2)
+            points.emplace_back(buffer[i], buffer[i + 1]);
+
+        if (!points.empty() && !sink(points.data(), points.size()))
+            return false;
+        points.clear();
+    }
+    return true;
+}
+
+/// receives every filled channel description, returns false to stop reading
+using PixelMapDescSink = function<bool(LedGrabDesc &&desc)>;
+
+/// Stream pixel map into GRAB_POINTS descriptions, channels are filled in order up to
+/// maxPixInChannel, channel index keeps growing so caller can split it between controllers.
+/// Only one description is held at a time, it is passed to descSink when full
+static bool ParsePixelMapToGrabDescs(const string &path, size_t maxPixInChannel,
+                                     size_t maxChannels, const PixelMapDescSink &descSink)
+{
+    ifstream file(ofToDataPath(path), ios::binary);
+    if (!file.is_open()) {
+        ofLogError() << "[ofxLedGrabPixelMapLoad] Can't open pixel map=" << path;
+        return false;
+    }
+
+    auto startTime = ofGetElapsedTimeMicros();
+    size_t totalPoints = 0;
+
+    LedGrabDesc desc;
+    desc.type = LMGrabType::GRAB_POINTS;
+    desc.points.reserve(maxPixInChannel);
+
+    auto sink = [&](const ofVec2f *points, size_t size) {
+        totalPoints += size;
+        while (size > 0) {
+            if (desc.points.size() == maxPixInChannel) {
+                if (static_cast<size_t>(desc.channel) + 1 >= maxChannels) {
+                    ofLogError() << "[ofxLedGrabPixelMapLoad] Pixel map=" << path
+                                 << " has more than " << maxChannels * maxPixInChannel << " leds";
+                    return false;
+                }
+                int channel = desc.channel + 1;
+                if (!descSink(move(desc)))
+                    return false;
+                desc = LedGrabDesc();
+                desc.type = LMGrabType::GRAB_POINTS;
+                desc.channel = channel;
+                desc.points.reserve(maxPixInChannel);
+            }
+            size_t count = std::min(size, maxPixInChannel - desc.points.size());
+            desc.points.insert(desc.points.end(), points, points + count);
+            points += count;
+            size -= count;
+        }
+        return true;
+    };
+
+    bool result
+        = IsPixelMapCsv(path) ? ReadPixelMapCsv(file, sink) : ReadPixelMapBinary(file, sink);
+
+    ofLogNotice() << "[ofxLedGrabPixelMapLoad] Read " << totalPoints << " points from " << path
+                  << " in " << (ofGetElapsedTimeMicros() - startTime) / 1000.f << "ms";
+
+    if (result && !desc.points.empty())
+        result = descSink(move(desc));
+    return result;
+}
+
+/// same as above, collects all descriptions
+static bool ParsePixelMapToGrabDescs(const string &path, size_t maxPixInChannel,
+                                     size_t maxChannels, vector<LedGrabDesc> &descs)
+{
+    descs.clear();
+    return ParsePixelMapToGrabDescs(path, maxPixInChannel, maxChannels,
+                                    [&descs](LedGrabDesc &&desc) {
+                                        descs.emplace_back(move(desc));
+                                        return true;
+                                    });
+}
+
+} // namespace LedMapper
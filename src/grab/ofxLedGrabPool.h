@@ -0,0 +1,296 @@
+/*
+ Copyright (C) 2017 Timofey Tavlintsev [http://tvl.io]
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+#pragma once
+
+#include "ofxLedGrabObject.h"
+#include <limits>
+#include <type_traits>
+
+namespace LedMapper {
+
+/// Reference to grab object stored in ofxLedGrabPool.
+/// Generation is bumped every time slot is freed, so stale handles resolve to nullptr
+struct GrabHandle {
+    static constexpr uint32_t s_invalidIndex = std::numeric_limits<uint32_t>::max();
+
+    uint32_t index = s_invalidIndex;
+    uint32_t generation = 0;
+
+    bool isValid() const { return index != s_invalidIndex; }
+    bool operator==(const GrabHandle &rhs) const
+    {
+        return index == rhs.index && generation == rhs.generation;
+    }
+    bool operator!=(const GrabHandle &rhs) const { return !(*this == rhs); }
+};
+
+/// Per controller storage for grab objects.
+/// Slots are allocated in fixed chunks and reused through free list, so bulk
+/// load / paste / delete don't hit the heap for every grab
+class ofxLedGrabPool {
+public:
+    ofxLedGrabPool() = default;
+    ofxLedGrabPool(const ofxLedGrabPool &) = delete;
+    ofxLedGrabPool &operator=(const ofxLedGrabPool &) = delete;
+    ofxLedGrabPool(ofxLedGrabPool &&) = default;
+    ofxLedGrabPool &operator=(ofxLedGrabPool &&other)
+    {
+        clear();
+        m_chunks = move(other.m_chunks);
+        m_freeSlots = move(other.m_freeSlots);
+        m_alive = other.m_alive;
+        other.m_alive = 0;
+        return *this;
+    }
+    ~ofxLedGrabPool() { clear(); }
+
+    template <typename T, typename... Args>
+    GrabHandle create(Args &&... args)
+    {
+        static_assert(std::is_base_of<ofxLedGrab, T>::value, "T must be derived from ofxLedGrab");
+        static_assert(sizeof(T) <= sizeof(Storage) && alignof(T) <= alignof(Storage),
+                      "Grab type must be listed in ofxLedGrabPool::Storage");
+
+        auto index = allocSlot();
+        auto &slot = getSlot(index);
+        slot.grab = new (&slot.storage) T(std::forward<Args>(args)...);
+        ++m_alive;
+        return { index, slot.generation };
+    }
+
+    /// create default grab by type, used by json and xml loaders
+    GrabHandle create(LMGrabType type)
+    {
+        switch (type) {
+            case LMGrabType::GRAB_LINE:
+                return create<ofxLedGrabLine>();
+            case LMGrabType::GRAB_CIRCLE:
+                return create<ofxLedGrabCircle>();
+            case LMGrabType::GRAB_MATRIX:
+                return create<ofxLedGrabMatrix>();
+            case LMGrabType::GRAB_POINTS:
+                return create<ofxLedGrabPoints>();
+            case LMGrabType::GRAB_PATH:
+                return create<ofxLedGrabPath>();
+            default:
+                break;
+        }
+        return {};
+    }
+
+    GrabHandle create(const LedGrabDesc &desc, float pixelsInLed)
+    {
+        GrabHandle handle;
+        switch (desc.type) {
+            case LMGrabType::GRAB_LINE:
+                handle = create<ofxLedGrabLine>(desc.from, desc.to, pixelsInLed, desc.isDouble);
+                break;
+            case LMGrabType::GRAB_CIRCLE: {
+                handle = create<ofxLedGrabCircle>(desc.from, desc.to, pixelsInLed);
+                auto circle = static_cast<ofxLedGrabCircle *>(get(handle));
+                circle->setStartAngle(desc.startAngle);
+                circle->setClockwise(desc.isClockwise);
+                circle->updatePoints();
+                break;
+            }
+            case LMGrabType::GRAB_MATRIX:
+                handle = create<ofxLedGrabMatrix>(desc.from, desc.to, pixelsInLed, desc.isVertical,
+                                                  desc.isZigzag);
+                break;
+            case LMGrabType::GRAB_POINTS:
+                handle = create<ofxLedGrabPoints>(desc.points);
+                break;
+            case LMGrabType::GRAB_PATH:
+                handle = create<ofxLedGrabPath>(desc.points, pixelsInLed, desc.isBezier);
+                break;
+            default:
+                return handle;
+        }
+        auto grab = get(handle);
+        grab->setChannel(desc.channel);
+        if (desc.hasColorCorrection)
+            grab->setColorCorrection(desc.colorCorrection);
+        return handle;
+    }
+
+    /// same as above, but points of GRAB_POINTS description are moved into grab
+    GrabHandle create(LedGrabDesc &&desc, float pixelsInLed)
+    {
+        if (desc.type != LMGrabType::GRAB_POINTS)
+            return create(static_cast<const LedGrabDesc &>(desc), pixelsInLed);
+
+        auto handle = create<ofxLedGrabPoints>(move(desc.points));
+        auto grab = get(handle);
+        grab->setChannel(desc.channel);
+        if (desc.hasColorCorrection)
+            grab->setColorCorrection(desc.colorCorrection);
+        return handle;
+    }
+
+    /// create grab with already generated points without running updatePoints
+    GrabHandle restore(const LedGrabDesc &desc, float pixelsInLed, const ofVec2f *points,
+                       size_t size)
+    {
+        auto handle = create(desc.type);
+        if (handle.isValid())
+            get(handle)->restore(desc, pixelsInLed, points, size);
+        return handle;
+    }
+
+    /// same as adl_serializer<unique_ptr<ofxLedGrab>>::from_json but allocates in pool
+    GrabHandle createFromJson(const ofJson &j)
+    {
+        if (j.is_null() || !j.count("type") || !j.at("type").is_number())
+            return {};
+
+        auto handle = create(j.at("type").get<LMGrabType>());
+        if (!handle.isValid())
+            return handle;
+
+        try {
+            get(handle)->fromJson(j);
+        }
+        catch (std::exception &ex) {
+            ofLogError() << "Parse Grab json failed with:" << ex.what();
+        }
+        return handle;
+    }
+
+    /// typed copy of grab from any pool or heap
+    GrabHandle clone(const ofxLedGrab &grab)
+    {
+        switch (grab.getType()) {
+            case LMGrabType::GRAB_LINE:
+                return create<ofxLedGrabLine>(static_cast<const ofxLedGrabLine &>(grab));
+            case LMGrabType::GRAB_CIRCLE:
+                return create<ofxLedGrabCircle>(static_cast<const ofxLedGrabCircle &>(grab));
+            case LMGrabType::GRAB_MATRIX:
+                return create<ofxLedGrabMatrix>(static_cast<const ofxLedGrabMatrix &>(grab));
+            case LMGrabType::GRAB_POINTS:
+                return create<ofxLedGrabPoints>(static_cast<const ofxLedGrabPoints &>(grab));
+            case LMGrabType::GRAB_PATH:
+                return create<ofxLedGrabPath>(static_cast<const ofxLedGrabPath &>(grab));
+            default:
+                break;
+        }
+        assert(false);
+        return {};
+    }
+
+    void destroy(GrabHandle handle)
+    {
+        auto grab = get(handle);
+        if (grab == nullptr)
+            return;
+
+        auto &slot = getSlot(handle.index);
+        grab->~ofxLedGrab();
+        slot.grab = nullptr;
+        ++slot.generation;
+        m_freeSlots.push_back(handle.index);
+        --m_alive;
+    }
+
+    /// returns nullptr when handle is stale or invalid
+    ofxLedGrab *get(GrabHandle handle) const
+    {
+        if (handle.index >= capacity())
+            return nullptr;
+        const auto &slot = getSlot(handle.index);
+        return slot.generation == handle.generation ? slot.grab : nullptr;
+    }
+
+    ofxLedGrab *operator[](GrabHandle handle) const
+    {
+        auto grab = get(handle);
+        assert(grab != nullptr);
+        return grab;
+    }
+
+    /// preallocate chunks for count grabs
+    void reserve(size_t count)
+    {
+        while (m_freeSlots.size() < count - std::min(count, m_alive))
+            addChunk();
+    }
+
+    /// destroy all grabs, allocated chunks are kept for reuse
+    void clear()
+    {
+        if (m_alive == 0)
+            return;
+        for (uint32_t i = 0; i < capacity(); ++i) {
+            auto &slot = getSlot(i);
+            if (slot.grab == nullptr)
+                continue;
+            destroy({ i, slot.generation });
+        }
+    }
+
+    size_t size() const { return m_alive; }
+    size_t capacity() const { return m_chunks.size() * s_chunkSize; }
+
+private:
+    static constexpr size_t s_chunkSize = 256;
+
+    using Storage = std::aligned_union_t<0, ofxLedGrabLine, ofxLedGrabCircle, ofxLedGrabMatrix,
+                                         ofxLedGrabPoints, ofxLedGrabPath>;
+    struct Slot {
+        Storage storage;
+        ofxLedGrab *grab = nullptr;
+        uint32_t generation = 0;
+    };
+
+    Slot &getSlot(uint32_t index) { return m_chunks[index / s_chunkSize][index % s_chunkSize]; }
+    const Slot &getSlot(uint32_t index) const
+    {
+        return m_chunks[index / s_chunkSize][index % s_chunkSize];
+    }
+
+    void addChunk()
+    {
+        uint32_t first = static_cast<uint32_t>(capacity());
+        m_chunks.emplace_back(new Slot[s_chunkSize]);
+        /// push in reverse to hand out lower indices first
+        for (uint32_t i = s_chunkSize; i > 0; --i)
+            m_freeSlots.push_back(first + i - 1);
+    }
+
+    uint32_t allocSlot()
+    {
+        if (m_freeSlots.empty())
+            addChunk();
+        auto index = m_freeSlots.back();
+        m_freeSlots.pop_back();
+        return index;
+    }
+
+    vector<unique_ptr<Slot[]>> m_chunks;
+    vector<uint32_t> m_freeSlots;
+    size_t m_alive = 0;
+};
+
+/// Grab handles split by output channel, order in channel is wiring order
+using ChannelsGrabObjects = vector<vector<GrabHandle>>;
+
+} // namespace LedMapper
@@ -5,16 +5,15 @@
 #pragma once
 
 #include "Common.h"
-#include "grab/ofxLedGrabs.h"
+#include "grab/ofxLedGrabPool.h"
 #include "ofMain.h"
 #include "ofxXmlSettings.h"
 
 namespace LedMapper {
 
 /// Deprecated load from XML
-static bool ParseXmlToGrabObjects(string xmlPath,
-                                  vector<vector<unique_ptr<ofxLedGrab>>> &channelGrabObjects,
-                                  ofJson &config)
+static bool ParseXmlToGrabObjects(string xmlPath, ofxLedGrabPool &grabPool,
+                                  ChannelsGrabObjects &channelGrabObjects, ofJson &config)
 {
     ofxXmlSettings XML;
     if (!XML.loadFile(xmlPath)) {
@@ -53,36 +52,41 @@ static bool ParseXmlToGrabObjects(string xmlPath,
         for (int i = 0; i < numPtTags; i++) {
             // the last argument of getValue can be used to specify
             // which tag out of multiple tags you are refering to.
-            unique_ptr<ofxLedGrab> tmpObj{ nullptr };
+            GrabHandle handle;
             if (XML.getValue("LN:TYPE", LMGrabType::GRAB_EMPTY, i) == LMGrabType::GRAB_LINE) {
-                tmpObj = make_unique<ofxLedGrabLine>(
+                handle = grabPool.create<ofxLedGrabLine>(
                     ofVec2f(XML.getValue("LN:fromX", 0, i), XML.getValue("LN:fromY", 0, i)),
                     ofVec2f(XML.getValue("LN:toX", 0, i), XML.getValue("LN:toY", 0, i)));
-                tmpObj->load(XML, i);
             }
             else if (XML.getValue("LN:TYPE", LMGrabType::GRAB_EMPTY, i)
                      == LMGrabType::GRAB_CIRCLE) {
-                tmpObj = make_unique<ofxLedGrabCircle>(
+                handle = grabPool.create<ofxLedGrabCircle>(
                     ofVec2f(XML.getValue("LN:fromX", 0, i), XML.getValue("LN:fromY", 0, i)),
                     ofVec2f(XML.getValue("LN:toX", 0, i), XML.getValue("LN:toY", 0, i)));
-                tmpObj->load(XML, i);
             }
             else if (XML.getValue("LN:TYPE", LMGrabType::GRAB_EMPTY, i)
                      == LMGrabType::GRAB_MATRIX) {
-                tmpObj = make_unique<ofxLedGrabMatrix>(
+                handle = grabPool.create<ofxLedGrabMatrix>(
                     ofVec2f(XML.getValue("LN:fromX", 0, i), XML.getValue("LN:fromY", 0, i)),
                     ofVec2f(XML.getValue("LN:toX", 0, i), XML.getValue("LN:toY", 0, i)));
-                tmpObj->load(XML, i);
             }
 
-            if (tmpObj == nullptr)
+            auto tmpObj = grabPool.get(handle);
+            if (tmpObj == nullptr) {
                 ofLogError() << "ofxLedController Malformed XML config, LN:TYPE unknown or empty"
                              << XML.getValue("LN:TYPE", 0, i);
+                continue;
+            }
+            tmpObj->load(XML, i);
 
             int chan = XML.getValue("LN:CHANNEL", 0, i);
+            if (chan < 0 || static_cast<size_t>(chan) >= channelGrabObjects.size()) {
+                grabPool.destroy(handle);
+                continue;
+            }
             tmpObj->setObjectId(channelGrabObjects[chan].size());
             tmpObj->setChannel(chan);
-            channelGrabObjects[chan].emplace_back(move(tmpObj));
+            channelGrabObjects[chan].emplace_back(handle);
         }
     }
     XML.popTag();
@@ -0,0 +1,487 @@
+/*
+ Copyright (C) 2017 Timofey Tavlintsev [http://tvl.io]
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+
+#include "ofxLedCapture.h"
+
+#ifdef TARGET_WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace LedMapper {
+
+#ifdef TARGET_WIN32
+static void *const s_noFile = INVALID_HANDLE_VALUE;
+#else
+static const int s_noFile = -1;
+#endif
+
+ofxLedCaptureWriter::ofxLedCaptureWriter()
+    : m_controllerId(0)
+    , m_bExit(false)
+    , m_frameSize(0)
+    , m_startTime(0)
+    , m_bSizeWarned(false)
+    , m_header(nullptr)
+    , m_fileSize(0)
+    , m_segment(nullptr)
+    , m_segmentIndex(0)
+    , m_numFrames(0)
+    , m_numDropped(0)
+    , m_bFailed(false)
+    , m_file(s_noFile)
+{
+}
+
+ofxLedCaptureWriter::~ofxLedCaptureWriter() { close(); }
+
+bool ofxLedCaptureWriter::open(const string &path, unsigned int controllerId)
+{
+    close();
+
+    m_path = ofToDataPath(path);
+#ifdef TARGET_WIN32
+    m_file = CreateFileA(m_path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+                         CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+#else
+    m_file = ::open(m_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+#endif
+    if (m_file == s_noFile) {
+        ofLogError() << "[ofxLedCaptureWriter] Can't create capture file=" << m_path;
+        return false;
+    }
+
+    m_controllerId = controllerId;
+    m_channelSizes.clear();
+    m_frameSize = m_startTime = m_fileSize = 0;
+    m_bSizeWarned = m_bExit = false;
+    m_numFrames = m_numDropped = 0;
+    m_bFailed = false;
+    m_thread = std::thread(&ofxLedCaptureWriter::threadedFunction, this);
+    return true;
+}
+
+void ofxLedCaptureWriter::close()
+{
+    if (!m_thread.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_bExit = true;
+    }
+    m_condition.notify_one();
+    m_thread.join();
+    m_freeBuffers.clear();
+
+    ofLogNotice() << "[ofxLedCaptureWriter] Recorded " << m_numFrames << " frames to " << m_path
+                  << ", dropped " << m_numDropped;
+}
+
+void ofxLedCaptureWriter::push(const ChannelsToPix &pixels, uint64_t time)
+{
+    if (m_bFailed)
+        return;
+
+    vector<char> data;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_bExit || !m_thread.joinable())
+            return;
+        if (m_channelSizes.empty()) {
+            for (const auto &channel : pixels) {
+                m_channelSizes.push_back(static_cast<uint32_t>(channel.size()));
+                m_frameSize += channel.size();
+            }
+            m_startTime = time;
+        }
+        if (m_frames.size() >= s_maxQueuedFrames) {
+            ++m_numDropped;
+            return;
+        }
+        if (!m_freeBuffers.empty()) {
+            data = move(m_freeBuffers.back());
+            m_freeBuffers.pop_back();
+        }
+    }
+
+    /// copy outside of lock, writer keeps going meanwhile
+    data.resize(m_frameSize);
+    bool sameSize = pixels.size() == m_channelSizes.size();
+    char *dst = data.data();
+    for (size_t chan = 0; chan < m_channelSizes.size(); ++chan) {
+        size_t size = chan < pixels.size() ? pixels[chan].size() : 0;
+        size_t count = std::min<size_t>(size, m_channelSizes[chan]);
+        if (count > 0)
+            memcpy(dst, pixels[chan].data(), count);
+        std::fill(dst + count, dst + m_channelSizes[chan], 0);
+        dst += m_channelSizes[chan];
+        sameSize &= size == m_channelSizes[chan];
+    }
+    if (!sameSize && !m_bSizeWarned) {
+        m_bSizeWarned = true;
+        ofLogWarning() << "[ofxLedCaptureWriter] Layout changed while recording " << m_path
+                       << ", frames are cut to size of first frame";
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_frames.push_back({ time - m_startTime, move(data) });
+    }
+    m_condition.notify_one();
+}
+
+void ofxLedCaptureWriter::threadedFunction()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_condition.wait(lock, [this] { return m_bExit || !m_frames.empty(); });
+        if (m_frames.empty())
+            break;
+
+        auto frame = move(m_frames.front());
+        m_frames.pop_front();
+        lock.unlock();
+
+        if (!m_bFailed && !writeFrame(frame)) {
+            m_bFailed = true;
+            ofLogError() << "[ofxLedCaptureWriter] Write to " << m_path
+                         << " failed, recording stopped";
+        }
+
+        lock.lock();
+        m_freeBuffers.emplace_back(move(frame.data));
+    }
+    lock.unlock();
+    closeFile();
+}
+
+bool ofxLedCaptureWriter::writeFrame(const Frame &frame)
+{
+    if (m_header == nullptr && !writeHeader())
+        return false;
+
+    uint64_t offset = m_header->dataOffset + m_numFrames * m_header->frameStride;
+    if (!write(offset, reinterpret_cast<const char *>(&frame.time), sizeof(frame.time))
+        || !write(offset + sizeof(frame.time), frame.data.data(), frame.data.size()))
+        return false;
+    /// record is complete, publish it
+    m_header->numFrames = ++m_numFrames;
+    return true;
+}
+
+/// first frame defines frame size, header stays mapped to update frames count
+bool ofxLedCaptureWriter::writeHeader()
+{
+    auto numChannels = static_cast<uint32_t>(m_channelSizes.size());
+    auto dataOffset = LedCaptureFormat::GetDataOffset(numChannels);
+    if (!resizeFile(std::max(2 * s_segmentSize, dataOffset)))
+        return false;
+    auto view = mapRegion(0, dataOffset);
+    if (view == nullptr)
+        return false;
+
+    m_header = reinterpret_cast<LedCaptureFormat::Header *>(view);
+    m_header->magic = LedCaptureFormat::s_magic;
+    m_header->version = LedCaptureFormat::s_version;
+    m_header->controllerId = m_controllerId;
+    m_header->numChannels = numChannels;
+    m_header->frameSize = m_frameSize;
+    m_header->frameStride = LedCaptureFormat::GetFrameStride(m_frameSize);
+    m_header->numFrames = 0;
+    m_header->dataOffset = dataOffset;
+    if (numChannels > 0)
+        memcpy(view + sizeof(LedCaptureFormat::Header), m_channelSizes.data(),
+               numChannels * sizeof(uint32_t));
+    return true;
+}
+
+/// record may cross segments border, then it's written by parts
+bool ofxLedCaptureWriter::write(uint64_t offset, const char *data, size_t size)
+{
+    while (size > 0) {
+        uint64_t index = offset / s_segmentSize;
+        if ((m_segment == nullptr || index != m_segmentIndex) && !mapSegment(index))
+            return false;
+        uint64_t inSegment = offset % s_segmentSize;
+        size_t count = static_cast<size_t>(std::min<uint64_t>(size, s_segmentSize - inSegment));
+        memcpy(m_segment + inSegment, data, count);
+        offset += count;
+        data += count;
+        size -= count;
+    }
+    return true;
+}
+
+bool ofxLedCaptureWriter::mapSegment(uint64_t index)
+{
+    unmapRegion(m_segment, s_segmentSize);
+    m_segment = nullptr;
+    /// keep one empty segment ahead, so file doesn't grow on every record
+    if ((index + 2) * s_segmentSize > m_fileSize && !resizeFile((index + 2) * s_segmentSize))
+        return false;
+    m_segment = mapRegion(index * s_segmentSize, s_segmentSize);
+    m_segmentIndex = index;
+    return m_segment != nullptr;
+}
+
+char *ofxLedCaptureWriter::mapRegion(uint64_t offset, size_t size)
+{
+#ifdef TARGET_WIN32
+    uint64_t end = offset + size;
+    HANDLE mapping = CreateFileMappingA(m_file, nullptr, PAGE_READWRITE, DWORD(end >> 32),
+                                        DWORD(end & 0xffffffff), nullptr);
+    if (mapping == nullptr)
+        return nullptr;
+    /// view keeps mapping alive
+    void *data = MapViewOfFile(mapping, FILE_MAP_WRITE, DWORD(offset >> 32),
+                               DWORD(offset & 0xffffffff), size);
+    CloseHandle(mapping);
+    return static_cast<char *>(data);
+#else
+    void *data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, m_file,
+                      static_cast<off_t>(offset));
+    return data != MAP_FAILED ? static_cast<char *>(data) : nullptr;
+#endif
+}
+
+void ofxLedCaptureWriter::unmapRegion(char *data, size_t size)
+{
+    if (data == nullptr)
+        return;
+#ifdef TARGET_WIN32
+    UnmapViewOfFile(data);
+#else
+    munmap(data, size);
+#endif
+}
+
+bool ofxLedCaptureWriter::resizeFile(uint64_t size)
+{
+#ifdef TARGET_WIN32
+    /// mapping bigger than file extends it, shrinking needs all views unmapped
+    bool result;
+    if (size > m_fileSize) {
+        HANDLE mapping = CreateFileMappingA(m_file, nullptr, PAGE_READWRITE, DWORD(size >> 32),
+                                            DWORD(size & 0xffffffff), nullptr);
+        result = mapping != nullptr;
+        if (result)
+            CloseHandle(mapping);
+    }
+    else {
+        LARGE_INTEGER pos;
+        pos.QuadPart = static_cast<LONGLONG>(size);
+        result = SetFilePointerEx(m_file, pos, nullptr, FILE_BEGIN) && SetEndOfFile(m_file);
+    }
+#else
+    bool result = ftruncate(m_file, static_cast<off_t>(size)) == 0;
+#endif
+    if (result)
+        m_fileSize = size;
+    return result;
+}
+
+/// cut preallocated tail, file without frames is removed
+void ofxLedCaptureWriter::closeFile()
+{
+    unmapRegion(m_segment, s_segmentSize);
+    m_segment = nullptr;
+    uint64_t size = 0;
+    if (m_header != nullptr) {
+        size = m_header->dataOffset + m_header->numFrames * m_header->frameStride;
+        unmapRegion(reinterpret_cast<char *>(m_header), m_header->dataOffset);
+        m_header = nullptr;
+    }
+    if (m_file == s_noFile)
+        return;
+    resizeFile(size);
+#ifdef TARGET_WIN32
+    CloseHandle(m_file);
+#else
+    ::close(m_file);
+#endif
+    m_file = s_noFile;
+
+    if (size == 0) {
+        std::error_code err;
+        std::filesystem::remove(m_path, err);
+    }
+}
+
+bool ofxLedCaptureReader::open(const string &path)
+{
+    close();
+
+    auto filePath = ofToDataPath(path);
+#ifdef TARGET_WIN32
+    m_file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                         nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (m_file == INVALID_HANDLE_VALUE) {
+        m_file = nullptr;
+        return false;
+    }
+    LARGE_INTEGER size;
+    GetFileSizeEx(m_file, &size);
+    m_size = static_cast<size_t>(size.QuadPart);
+    if (m_size > 0)
+        m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m_mapping != nullptr)
+        m_data = static_cast<const char *>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+    int fd = ::open(filePath.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        m_size = static_cast<size_t>(st.st_size);
+        void *data = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (data != MAP_FAILED) {
+            m_data = static_cast<const char *>(data);
+            madvise(data, m_size, MADV_SEQUENTIAL);
+        }
+    }
+    ::close(fd);
+#endif
+
+    if (m_data == nullptr) {
+        ofLogError() << "[ofxLedCaptureReader] Can't map file=" << filePath;
+        close();
+        return false;
+    }
+
+    bool valid = m_size >= sizeof(LedCaptureFormat::Header)
+                 && header()->magic == LedCaptureFormat::s_magic
+                 && header()->version == LedCaptureFormat::s_version
+                 && header()->dataOffset == LedCaptureFormat::GetDataOffset(header()->numChannels)
+                 && header()->dataOffset <= m_size
+                 && header()->frameStride == LedCaptureFormat::GetFrameStride(header()->frameSize);
+    uint64_t frameSize = 0;
+    for (uint32_t i = 0; valid && i < header()->numChannels; ++i)
+        frameSize += channelSizes()[i];
+    valid = valid && frameSize == header()->frameSize;
+
+    if (!valid) {
+        ofLogError() << "[ofxLedCaptureReader] Wrong or corrupted capture file=" << filePath;
+        close();
+        return false;
+    }
+
+    /// recording that didn't finish has preallocated tail or last record cut
+    m_numFrames = static_cast<size_t>(std::min<uint64_t>(
+        header()->numFrames, (m_size - header()->dataOffset) / header()->frameStride));
+    m_prefetchBegin = m_prefetchEnd = 0;
+    return true;
+}
+
+void ofxLedCaptureReader::close()
+{
+#ifdef TARGET_WIN32
+    if (m_data != nullptr)
+        UnmapViewOfFile(m_data);
+    if (m_mapping != nullptr)
+        CloseHandle(m_mapping);
+    if (m_file != nullptr)
+        CloseHandle(m_file);
+    m_file = m_mapping = nullptr;
+#else
+    if (m_data != nullptr)
+        munmap(const_cast<char *>(m_data), m_size);
+#endif
+    m_data = nullptr;
+    m_size = 0;
+    m_numFrames = 0;
+}
+
+uint64_t ofxLedCaptureReader::getFrameTime(size_t index) const
+{
+    uint64_t time;
+    memcpy(&time, record(index), sizeof(time));
+    return time;
+}
+
+uint64_t ofxLedCaptureReader::getLoopLength() const
+{
+    if (m_numFrames < 2)
+        return 0;
+    auto last = getFrameTime(m_numFrames - 1);
+    return last + last - getFrameTime(m_numFrames - 2);
+}
+
+size_t ofxLedCaptureReader::findFrame(uint64_t time, size_t hint) const
+{
+    if (m_numFrames == 0)
+        return 0;
+    if (hint < m_numFrames && getFrameTime(hint) <= time) {
+        if (hint + 1 == m_numFrames || getFrameTime(hint + 1) > time)
+            return hint;
+        if (hint + 2 == m_numFrames || getFrameTime(hint + 2) > time)
+            return hint + 1;
+    }
+    /// frames are written in time order
+    size_t first = 0, count = m_numFrames;
+    while (count > 1) {
+        size_t half = count / 2;
+        if (getFrameTime(first + half) <= time)
+            first += half;
+        count -= half;
+    }
+    return first;
+}
+
+void ofxLedCaptureReader::readFrame(size_t index, ChannelsToPix &pixels)
+{
+    if (index >= m_numFrames)
+        return;
+    prefetch(index);
+    const char *src = record(index) + sizeof(uint64_t);
+    pixels.resize(header()->numChannels);
+    for (uint32_t chan = 0; chan < header()->numChannels; ++chan) {
+        pixels[chan].assign(src, src + channelSizes()[chan]);
+        src += channelSizes()[chan];
+    }
+}
+
+void ofxLedCaptureReader::prefetch(size_t index)
+{
+    uint64_t begin = header()->dataOffset + index * header()->frameStride;
+    /// next window is requested in the middle of current one, seek starts new window
+    if (begin >= m_prefetchBegin && begin + s_prefetchSize / 2 < m_prefetchEnd)
+        return;
+    m_prefetchBegin = begin;
+    m_prefetchEnd = std::min<uint64_t>(begin + s_prefetchSize, m_size);
+    auto size = static_cast<size_t>(m_prefetchEnd - begin);
+#ifdef TARGET_WIN32
+    WIN32_MEMORY_RANGE_ENTRY range{ const_cast<char *>(m_data) + begin, size };
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+    /// madvise needs page aligned start
+    auto pageSize = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    auto offset = begin % pageSize;
+    madvise(const_cast<char *>(m_data) + begin - offset, size + offset, MADV_WILLNEED);
+#endif
+}
+
+} // namespace LedMapper
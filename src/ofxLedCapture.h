@@ -0,0 +1,200 @@
+/*
+ Copyright (C) 2017 Timofey Tavlintsev [http://tvl.io]
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+
+#pragma once
+
+#include "Common.h"
+#include "ofMain.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace LedMapper {
+
+/// Capture of frames sent by one controller, written as Capture-N.lmrec.
+/// Frame size is fixed when first frame comes, so frame i is at
+/// dataOffset + i * frameStride and any frame is found without index table.
+/// Layout (little-endian):
+///     Header
+///     uint32 channelSizes[numChannels]   bytes of every channel in frame
+///     Record[numFrames]                  from dataOffset, frameStride each
+/// Record is uint64 time in usec from start of recording, then channels one after
+/// another, channel longer than its recorded size is cut and shorter is padded with zeros
+struct LedCaptureFormat {
+    static constexpr uint32_t s_magic = 0x43524d4c; /// "LMRC"
+    static constexpr uint32_t s_version = 1;
+
+    struct Header {
+        uint32_t magic, version;
+        uint32_t controllerId, numChannels;
+        uint64_t frameSize, frameStride;
+        /// updated after every written record, so file of crashed recording stays readable
+        uint64_t numFrames;
+        uint64_t dataOffset;
+    };
+
+    static uint64_t GetDataOffset(uint32_t numChannels)
+    {
+        return Align(sizeof(Header) + numChannels * sizeof(uint32_t));
+    }
+    static uint64_t GetFrameStride(uint64_t frameSize)
+    {
+        return Align(sizeof(uint64_t) + frameSize);
+    }
+    static uint64_t Align(uint64_t size) { return (size + 7) & ~uint64_t(7); }
+};
+
+/// Appends frames to memory mapped capture file on its own thread.
+/// push copies frame into recycled buffer and returns, file is grown in preallocated
+/// segments by writer thread, so output thread never waits for disk.
+/// Frames are dropped when writer is behind by s_maxQueuedFrames
+class ofxLedCaptureWriter {
+public:
+    ofxLedCaptureWriter();
+    ofxLedCaptureWriter(const ofxLedCaptureWriter &) = delete;
+    ofxLedCaptureWriter &operator=(const ofxLedCaptureWriter &) = delete;
+    /// writes queued frames and closes file
+    ~ofxLedCaptureWriter();
+
+    /// create file and start writer thread, returns false when file can't be created
+    bool open(const string &path, unsigned int controllerId);
+    void close();
+    bool isOpen() const { return m_thread.joinable(); }
+
+    /// queue copy of output frame, time in usec
+    void push(const ChannelsToPix &pixels, uint64_t time);
+
+    uint64_t getNumFrames() const { return m_numFrames; }
+    uint64_t getNumDropped() const { return m_numDropped; }
+    /// false after write error, frames are not recorded anymore
+    bool isOk() const { return !m_bFailed; }
+
+    static constexpr size_t s_maxQueuedFrames = 64;
+    /// file grows by segments, multiple of allocation granularity on every platform
+    static constexpr uint64_t s_segmentSize = 64 << 20;
+
+private:
+    struct Frame {
+        uint64_t time;
+        vector<char> data;
+    };
+
+    void threadedFunction();
+    bool writeFrame(const Frame &frame);
+    bool writeHeader();
+    bool write(uint64_t offset, const char *data, size_t size);
+    /// map segment by index, next one is allocated in file ahead of time
+    bool mapSegment(uint64_t index);
+    char *mapRegion(uint64_t offset, size_t size);
+    void unmapRegion(char *data, size_t size);
+    bool resizeFile(uint64_t size);
+    void closeFile();
+
+    string m_path;
+    unsigned int m_controllerId;
+
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::deque<Frame> m_frames;
+    vector<vector<char>> m_freeBuffers;
+    bool m_bExit;
+
+    /// set by first frame
+    vector<uint32_t> m_channelSizes;
+    uint64_t m_frameSize, m_startTime;
+    bool m_bSizeWarned;
+
+    /// writer thread only
+    LedCaptureFormat::Header *m_header;
+    uint64_t m_fileSize;
+    char *m_segment;
+    uint64_t m_segmentIndex;
+
+    std::atomic<uint64_t> m_numFrames, m_numDropped;
+    std::atomic<bool> m_bFailed;
+
+#ifdef TARGET_WIN32
+    void *m_file;
+#else
+    int m_file;
+#endif
+};
+
+/// Reads capture file written by ofxLedCaptureWriter through read-only mapping.
+/// Frames are copied straight from mapped file, pages ahead of sequential reads are
+/// requested from OS in windows of s_prefetchSize. Not thread safe, used by one player
+class ofxLedCaptureReader {
+public:
+    ofxLedCaptureReader() = default;
+    ofxLedCaptureReader(const ofxLedCaptureReader &) = delete;
+    ofxLedCaptureReader &operator=(const ofxLedCaptureReader &) = delete;
+    ~ofxLedCaptureReader() { close(); }
+
+    /// map file and validate header, returns false on missing or corrupt file
+    bool open(const string &path);
+    void close();
+    bool isOpen() const { return m_data != nullptr; }
+
+    unsigned int getControllerId() const { return header()->controllerId; }
+    size_t getNumFrames() const { return m_numFrames; }
+    /// time of frame in usec from start of recording
+    uint64_t getFrameTime(size_t index) const;
+    /// time from first frame to the one after last, last frame keeps previous interval
+    uint64_t getLoopLength() const;
+    /// last frame with time not later than given, checks hint and next to it first,
+    /// so sequential playback doesn't search
+    size_t findFrame(uint64_t time, size_t hint = 0) const;
+    /// copy frame into channels, buffers of pixels are reused
+    void readFrame(size_t index, ChannelsToPix &pixels);
+
+    static constexpr uint64_t s_prefetchSize = 8 << 20;
+
+private:
+    const LedCaptureFormat::Header *header() const
+    {
+        return reinterpret_cast<const LedCaptureFormat::Header *>(m_data);
+    }
+    const uint32_t *channelSizes() const
+    {
+        return reinterpret_cast<const uint32_t *>(m_data + sizeof(LedCaptureFormat::Header));
+    }
+    const char *record(size_t index) const
+    {
+        return m_data + header()->dataOffset + index * header()->frameStride;
+    }
+    /// advise OS to read next window when playback passes half of previous one
+    void prefetch(size_t index);
+
+    const char *m_data = nullptr;
+    size_t m_size = 0;
+    size_t m_numFrames = 0;
+    uint64_t m_prefetchBegin = 0, m_prefetchEnd = 0;
+#ifdef TARGET_WIN32
+    void *m_file = nullptr, *m_mapping = nullptr;
+#endif
+};
+
+} // namespace LedMapper
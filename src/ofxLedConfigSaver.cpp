@@ -0,0 +1,139 @@
+/*
+ Copyright (C) 2017 Timofey Tavlintsev [http://tvl.io]
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+
+#include "ofxLedConfigSaver.h"
+#include "ofxLedLayoutBin.h"
+
+namespace LedMapper {
+
+ofxLedConfigSaver::ofxLedConfigSaver()
+    : m_bBusy(false)
+    , m_bExit(false)
+    , m_bFailed(false)
+{
+    m_thread = std::thread(&ofxLedConfigSaver::threadedFunction, this);
+}
+
+ofxLedConfigSaver::~ofxLedConfigSaver()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_bExit = true;
+    }
+    m_condition.notify_one();
+    m_thread.join();
+}
+
+void ofxLedConfigSaver::save(LedConfigSaveJob &&job)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.emplace_back(move(job));
+    }
+    m_condition.notify_one();
+}
+
+void ofxLedConfigSaver::waitForSave()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_doneCondition.wait(lock, [this] { return m_jobs.empty() && !m_bBusy; });
+}
+
+bool ofxLedConfigSaver::isSaving()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return !m_jobs.empty() || m_bBusy;
+}
+
+void ofxLedConfigSaver::threadedFunction()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_condition.wait(lock, [this] { return m_bExit || !m_jobs.empty(); });
+        if (m_jobs.empty())
+            return;
+
+        auto job = move(m_jobs.front());
+        m_jobs.pop_front();
+        m_bBusy = true;
+        lock.unlock();
+
+        auto startTime = ofGetElapsedTimeMicros();
+        if (!process(job))
+            m_bFailed = true;
+        ofLogNotice() << "[ofxLedConfigSaver] Save " << job.dirtyIds.size() << " of "
+                      << job.controllers.size() << " controllers to " << job.folder << " in "
+                      << (ofGetElapsedTimeMicros() - startTime) / 1000.f << "ms";
+
+        lock.lock();
+        m_bBusy = false;
+        m_doneCondition.notify_all();
+    }
+}
+
+bool ofxLedConfigSaver::process(const LedConfigSaveJob &job)
+{
+    bool result = true;
+    auto folder = ofFilePath::addTrailingSlash(job.folder);
+
+    set<string> configNames;
+    for (const auto &config : job.controllers) {
+        configNames.insert(LCFileName + ofToString(config->id) + ".json");
+        if (job.dirtyIds.count(config->id) && !WriteJson(folder, *config)) {
+            ofLogError() << "[ofxLedConfigSaver] Can't write config of controller " << config->id;
+            result = false;
+        }
+    }
+
+    /// configs of deleted controllers and older xml ones
+    std::error_code err;
+    for (const auto &entry : std::filesystem::directory_iterator(ofToDataPath(folder), err)) {
+        auto name = entry.path().filename().string();
+        if (name.compare(0, LCFileName.size(), LCFileName) == 0 && !configNames.count(name))
+            std::filesystem::remove(entry.path(), err);
+    }
+
+    return ofxLedLayoutBin::Write(folder + LMLayoutBinFileName, job.controllers) && result;
+}
+
+bool ofxLedConfigSaver::WriteJson(const string &folder, const LedControllerConfig &config)
+{
+    ofJson json = config.settings;
+
+    ofJson grabs_array = ofJson::array();
+    for (const auto &channelGrabs : config.channelGrabObjects)
+        for (auto handle : channelGrabs)
+            grabs_array.emplace_back(config.grabPool[handle]->toJson());
+
+    if (!grabs_array.empty())
+        json["grabs"] = move(grabs_array);
+
+    return WriteFileAtomic(ofFilePath::addTrailingSlash(folder) + LCFileName
+                               + ofToString(config.id) + ".json",
+                           [&json](ostream &file) {
+                               file << json.dump(4);
+                               return bool(file);
+                           });
+}
+
+} // namespace LedMapper
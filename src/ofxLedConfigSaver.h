@@ -0,0 +1,76 @@
+/*
+ Copyright (C) 2017 Timofey Tavlintsev [http://tvl.io]
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+
+#pragma once
+
+#include "ofxLedController.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <thread>
+
+namespace LedMapper {
+
+/// Controllers snapshot taken on main thread for ofxLedConfigSaver
+struct LedConfigSaveJob {
+    string folder;
+    /// all controllers, used for compiled layout and to remove configs of deleted ones
+    vector<shared_ptr<const LedControllerConfig>> controllers;
+    /// controllers with changed config, only their json is written
+    set<unsigned int> dirtyIds;
+};
+
+/// Writes controller configs on background thread.
+/// Every file is written to temporary one and renamed, so crash mid save keeps previous show
+class ofxLedConfigSaver {
+public:
+    ofxLedConfigSaver();
+    ofxLedConfigSaver(const ofxLedConfigSaver &) = delete;
+    ofxLedConfigSaver &operator=(const ofxLedConfigSaver &) = delete;
+    /// finishes queued saves
+    ~ofxLedConfigSaver();
+
+    void save(LedConfigSaveJob &&job);
+    /// block until queued saves are written
+    void waitForSave();
+    bool isSaving();
+    /// returns true once after any save failed
+    bool checkFailed() { return m_bFailed.exchange(false); }
+
+    static bool WriteJson(const string &folder, const LedControllerConfig &config);
+
+private:
+    void threadedFunction();
+    bool process(const LedConfigSaveJob &job);
+
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_condition, m_doneCondition;
+    std::deque<LedConfigSaveJob> m_jobs;
+    bool m_bBusy, m_bExit;
+    std::atomic<bool> m_bFailed;
+};
+
+} // namespace LedMapper
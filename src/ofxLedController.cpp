@@ -21,49 +21,68 @@
  */
 
 #include "ofxLedController.h"
+#include "grab/ofxLedGrabJsonLoad.h"
+#include "grab/ofxLedGrabPixelMapLoad.h"
 #include "grab/ofxLedGrabXmlLoad.h"
+#include "ofxLedConfigSaver.h"
 #include "ofxLedPixelGrab.h"
 
 namespace LedMapper {
 
 ofxLedController::ofxLedController(int _id, LedOutputType outputType, const string &_path)
-    : m_id(_id)
+    : ofxLedController(ReadConfig(_id, outputType, _path), _path)
+{
+}
+
+ofxLedController::ofxLedController(LedControllerConfig &&config, const string &_path)
+    : m_id(config.id)
     , m_path(_path)
     , m_bSelected(false)
     , m_bSend(false)
-    , m_statusOk(false)
     , m_bDirtyPoints(false)
+    , m_statusOk(false)
+    , m_bStatusChanged(false)
     , m_colorLine(ofColor(ofRandom(0, 100), ofRandom(50, 200), ofRandom(150, 255)))
     , m_colorActive(ofColor(0, m_colorLine.g, m_colorLine.b, 200))
     , m_colorInactive(ofColor(m_colorLine.r, m_colorLine.g, 0, 200))
+    , m_interpolation(LED_INTERPOLATION_OFF)
+    , m_mergeMode(LED_MERGE_HTP)
+    , m_bThreadExit(false)
+    , m_layout(make_shared<LedLayout>())
+    , m_uploadedRevision(0)
+    , m_bCpuGather(false)
+    , m_bDirtyLayout(false)
+    , m_statusChanged(nullptr)
+    , m_currentChannelNum(0)
     , m_currentGrabType(LMGrabType::GRAB_SELECT)
     , m_grabBounds(0, 0, 100, 100)
+    , m_colorType(GRAB_COLOR_TYPE::RGB)
+    , m_colorLut(make_shared<ofxLedColorLut>())
+    , m_bDither(false)
+    , m_bRecording(false)
+    , m_playIndex(0)
+    , m_bPlaying(false)
+    , m_bPlayLoop(true)
+    , m_playStart(0)
+    , m_bHasFadeFrom(false)
+    , m_fadeFromStart(0)
     , m_pixelsInLed(5.f)
     , m_fps(25.f)
-    , m_totalLeds(0)
-    , m_statusChanged(nullptr)
-    , m_currentChannelNum(0)
-    , m_ledPoints(0)
+    , m_lastFrameTime(0)
+    , m_nextFrameTime(0)
+    , m_idleReleaseTime(s_defaultIdleReleaseTime)
+    , m_bResourcesActive(false)
+    , m_layoutRevision(0)
+    , m_savedLayoutRevision(0)
+    , m_settingsRevision(0)
+    , m_savedSettingsRevision(0)
+    , m_snapshotLayoutRevision(0)
+    , m_snapshotSettingsRevision(0)
     , m_selectionRect(0, 0, 0, 0)
 {
-    m_ledOut = CreateLedOutput(outputType);
-    m_channelList = LedOutputGetChannels(m_ledOut);
-    auto maxPixelsOut = LedOutputGetMaxPixels(m_ledOut);
-    m_maxPixInChannel = maxPixelsOut / m_channelList.size();
-    m_channelsTotalLeds.resize(m_channelList.size(), 0);
-    m_channelGrabObjects.resize(m_channelList.size());
-
-    setColorType(GRAB_COLOR_TYPE::RGB);
     setFps(m_fps);
 
-    m_fboLeds.allocate(500, ceil(maxPixelsOut / 500.f), GL_RGB);
-    m_fboLeds.begin();
-    ofClear(0, 0, 0, 255);
-    m_fboLeds.end();
-
-    load(m_path);
-
-    setCurrentChannel(m_currentChannelNum);
+    applyConfig(move(config));
 
     ofAddListener(ofEvents().mousePressed, this, &ofxLedController::mousePressed);
     ofAddListener(ofEvents().mouseReleased, this, &ofxLedController::mouseReleased);
@@ -76,7 +95,11 @@ ofxLedController::~ofxLedController()
 {
     ofLogVerbose("[ofxLedController] Dtor: clear lines + remove event listeners + remove gui");
     disableEvents();
+    stopPlayback();
+    stopOutputThread();
+    stopRecording();
     m_channelGrabObjects.clear();
+    m_grabPool.clear();
 }
 
 /// Disable mouse/key events to explicitly call from ofxLedMapper
@@ -105,11 +128,15 @@ void ofxLedController::bindGui(ofxDatGui *gui)
 
     gui->addToggle(LCGUIButtonSend, m_bSend)->onToggleEvent([this](ofxDatGuiToggleEvent e) {
         m_bSend = e.checked;
-        if (m_bSend)
+        this->markSettingsChanged();
+        /// inactive output connects on first frame, see beginFrame
+        if (m_bSend && m_bResourcesActive) {
+            auto lock = lockOutput();
             LedOutputResetup(m_ledOut);
+        }
     });
 
-    auto slider = gui->addSlider(LMGUISliderFps, 10, 60);
+    auto slider = gui->addSlider(LMGUISliderFps, 10, 240);
     slider->setPrecision(0);
     slider->setValue(m_fps);
     slider->onSliderEvent([this](ofxDatGuiSliderEvent e) { this->setFps(e.value); });
@@ -124,7 +151,96 @@ void ofxLedController::bindGui(ofxDatGui *gui)
     dropdown->onDropdownEvent(
         [this](ofxDatGuiDropdownEvent e) { this->setColorType(GetColorType(e.child)); });
 
-    LedOutputBindGui(m_ledOut, gui);
+    slider = gui->addSlider(LCGUISliderGamma, 0.1, 4);
+    slider->setPrecision(2);
+    slider->setValue(m_colorCorrection.gamma);
+    slider->onSliderEvent([this](ofxDatGuiSliderEvent e) {
+        auto correction = m_colorCorrection;
+        correction.gamma = e.value;
+        this->setColorCorrection(correction);
+    });
+
+    slider = gui->addSlider(LCGUISliderBrightness, 0, 1);
+    slider->setPrecision(2);
+    slider->setValue(m_colorCorrection.brightness);
+    slider->onSliderEvent([this](ofxDatGuiSliderEvent e) {
+        auto correction = m_colorCorrection;
+        correction.brightness = e.value;
+        this->setColorCorrection(correction);
+    });
+
+    const std::array<string, 3> whiteLabels{ { LCGUISliderWhiteR, LCGUISliderWhiteG,
+                                               LCGUISliderWhiteB } };
+    for (size_t i = 0; i < whiteLabels.size(); ++i) {
+        slider = gui->addSlider(whiteLabels[i], 0, 1);
+        slider->setPrecision(2);
+        slider->setValue(m_colorCorrection.whiteBalance[i]);
+        slider->onSliderEvent([this, i](ofxDatGuiSliderEvent e) {
+            auto correction = m_colorCorrection;
+            correction.whiteBalance[i] = e.value;
+            this->setColorCorrection(correction);
+        });
+    }
+
+    gui->addToggle(LCGUIToggleDither, m_bDither)->onToggleEvent([this](ofxDatGuiToggleEvent e) {
+        this->setDithering(e.checked);
+    });
+
+    LedOutputBindGui(m_ledOut, gui, [this]() { this->markSettingsChanged(); });
+
+    dropdown = gui->addDropdown(LCGUIDropInterpolation, s_interpolationTypes);
+    dropdown->select(m_interpolation);
+    dropdown->onDropdownEvent([this](ofxDatGuiDropdownEvent e) {
+        this->setInterpolation(static_cast<LedInterpolation>(e.child));
+    });
+
+    dropdown = gui->addDropdown(LCGUIDropSmoothing, s_smoothingTypes);
+    dropdown->select(m_smoothing.getType());
+    dropdown->onDropdownEvent([this](ofxDatGuiDropdownEvent e) {
+        m_smoothing.setType(static_cast<LedSmoothingType>(e.child));
+        this->markSettingsChanged();
+    });
+
+    slider = gui->addSlider(LCGUISliderSmoothTime, 0, 1000);
+    slider->setPrecision(0);
+    slider->setValue(m_smoothing.getTimeConstant());
+    slider->onSliderEvent([this](ofxDatGuiSliderEvent e) {
+        m_smoothing.setTimeConstant(e.value);
+        this->markSettingsChanged();
+    });
+
+    slider = gui->addSlider(LCGUISliderSlewRate, 10, 5000);
+    slider->setPrecision(0);
+    slider->setValue(m_smoothing.getSlewRate());
+    slider->onSliderEvent([this](ofxDatGuiSliderEvent e) {
+        m_smoothing.setSlewRate(e.value);
+        this->markSettingsChanged();
+    });
+
+    gui->addTextInput(LCGUITextSource, m_source)
+        ->onTextInputEvent([this](ofxDatGuiTextInputEvent e) { this->setSource(e.text); });
+
+    dropdown = gui->addDropdown(LCGUIDropMergeMode, s_mergeModes);
+    dropdown->select(m_mergeMode);
+    dropdown->onDropdownEvent([this](ofxDatGuiDropdownEvent e) {
+        this->setMergeMode(static_cast<LedMergeMode>(e.child));
+    });
+
+    slider = gui->addSlider(LCGUISliderChannelAmps, 0, 60);
+    slider->setPrecision(1);
+    slider->setValue(m_powerLimiter.getChannelBudget());
+    slider->onSliderEvent([this](ofxDatGuiSliderEvent e) {
+        m_powerLimiter.setChannelBudget(e.value);
+        this->markSettingsChanged();
+    });
+
+    slider = gui->addSlider(LCGUISliderControllerAmps, 0, 200);
+    slider->setPrecision(1);
+    slider->setValue(m_powerLimiter.getControllerBudget());
+    slider->onSliderEvent([this](ofxDatGuiSliderEvent e) {
+        m_powerLimiter.setControllerBudget(e.value);
+        this->markSettingsChanged();
+    });
 
     dropdown = gui->addDropdown(LCGUIDropChannelNum, m_channelList);
     dropdown->select(m_currentChannelNum);
@@ -143,6 +259,9 @@ void ofxLedController::draw()
 
     m_bSelected ? ofSetColor(m_colorActive) : ofSetColor(50);
 
+    updateGrabPoints();
+    uploadLayout(*peekLayout());
+
     GLfloat pointSize;
     glGetFloatv(GL_POINT_SIZE, &pointSize);
     glPointSize(m_pixelsInLed / 2);
@@ -152,8 +271,8 @@ void ofxLedController::draw()
     ofColor color;
     for (auto &channelGrabs : m_channelGrabObjects) {
         color = (chanNum == m_currentChannelNum ? m_colorActive : m_colorInactive);
-        for (auto &grab : channelGrabs) {
-            grab->draw(color);
+        for (auto handle : channelGrabs) {
+            m_grabPool[handle]->draw(color);
         }
         ++chanNum;
     }
@@ -167,6 +286,8 @@ void ofxLedController::draw()
     }
 
     /// draw grabbed texture
+    if (!m_fboLeds.isAllocated())
+        return;
     ofSetColor(255);
     m_fboLeds.draw(0, ofGetHeight() - m_fboLeds.getHeight());
 }
@@ -174,70 +295,472 @@ void ofxLedController::draw()
 /// Send by UDP grab points data updated with grabbedImg
 void ofxLedController::send(const ofTexture &texIn)
 {
-    updateGrabPoints();
+    sendSampled([&](const LedLayout &layout) { return samplePixels(texIn, layout); });
+}
 
-    auto now = ofGetSystemTimeMillis();
+/// Same as send(texture) but samples CPU pixels, doesn't need GL context
+void ofxLedController::send(const ofPixels &pixIn)
+{
+    enableCpuGather();
+    sendSampled([&](const LedLayout &layout) { return samplePixels(pixIn, layout); });
+}
 
-    if (!m_bSend || now - m_lastFrameTime < m_msecInFrame)
+/// Sample every layer at LED positions and merge them with controller merge mode,
+/// sources are never composited in full resolution
+void ofxLedController::send(const vector<LedSourceLayer> &layers)
+{
+    /// source without frame, LEDs keep last one
+    if (none_of(layers.begin(), layers.end(),
+                [](const auto &layer) { return layer.texture || layer.pixels; }))
         return;
+    if (any_of(layers.begin(), layers.end(), [](const auto &layer) { return layer.pixels; }))
+        enableCpuGather();
+    sendSampled([&](const LedLayout &layout) { return compositeLayers(layers, layout); });
+}
 
-    m_lastFrameTime = now;
+void ofxLedController::send(const vector<LedSourceLayer> &from, const vector<LedSourceLayer> &to,
+                            const LedCueFade &fade)
+{
+    auto hasFrame = [](const vector<LedSourceLayer> &layers) {
+        return any_of(layers.begin(), layers.end(),
+                      [](const auto &layer) { return layer.texture || layer.pixels; });
+    };
+    /// source without frame, LEDs keep last one
+    if (!hasFrame(to))
+        return;
+    if (any_of(from.begin(), from.end(), [](const auto &layer) { return layer.pixels; })
+        || any_of(to.begin(), to.end(), [](const auto &layer) { return layer.pixels; }))
+        enableCpuGather();
+
+    /// frame to fade from is taken once per fade start, so fade interrupted by another one
+    /// continues from the mix that is on LEDs
+    if (fade.isFading(ofGetElapsedTimeMicros())
+        && (!m_bHasFadeFrom || m_fadeFromStart != fade.start)) {
+        m_fadeFrom = m_lastFrame;
+        m_fadeFromStart = fade.start;
+        m_bHasFadeFrom = true;
+    }
+    bool fromSource = hasFrame(from);
+    sendSampled(
+        [&](const LedLayout &layout) {
+            auto target = compositeLayers(to, layout);
+            float progress = fade.getProgress(ofGetElapsedTimeMicros());
+            if (progress >= 1.f)
+                return target;
+            auto output = fromSource ? compositeLayers(from, layout) : m_fadeFrom;
+            /// frame from before layout change fades from black
+            output.resize(target.size());
+            for (size_t chan = 0; chan < target.size(); ++chan)
+                output[chan].resize(target[chan].size(), 0);
+            CompositeLayer(output, target, LED_MERGE_ALPHA, progress);
+            return output;
+        },
+        true);
+}
 
-    auto grabbedPixs = updatePixels(texIn);
+void ofxLedController::enableCpuGather()
+{
+    if (m_bCpuGather)
+        return;
+    /// sample table is compiled with next layout, frames before go in wiring order
+    m_bCpuGather = true;
+    m_bDirtyLayout = true;
+}
 
-    bool prevStatus = m_statusOk;
+/// Sample frame with layout snapshot and send it now, or hand it to output thread
+/// when interpolation is on
+void ofxLedController::sendSampled(const function<ChannelsToPix(const LedLayout &)> &sample,
+                                   bool keepFrame)
+{
+    if (m_bPlaying)
+        return;
+    /// editor that sends without draw or ofxLedMapper::update still publishes its edits
+    if (std::this_thread::get_id() == m_editorThread)
+        updateGrabPoints();
+    if (!keepFrame) {
+        m_lastFrame.clear();
+        m_bHasFadeFrom = false;
+    }
+    updateOutputThread();
+    if (m_interpolation != LED_INTERPOLATION_OFF) {
+        if (!m_bSend) {
+            releaseIfIdle();
+            return;
+        }
+        auto layout = peekLayout();
+        auto pixels = sample(*layout);
+        if (keepFrame)
+            m_lastFrame = pixels;
+        pushFrame(move(pixels), layout);
+        return;
+    }
+    if (!beginFrame())
+        return;
+    /// hold snapshot for the whole frame, editor may publish new one meanwhile
+    auto layout = peekLayout();
+    auto pixels = sample(*layout);
+    if (keepFrame)
+        m_lastFrame = pixels;
+    processPixels(*layout, pixels);
+    sendFrame(move(pixels));
+    notifyStatusChange();
+}
+
+ChannelsToPix ofxLedController::compositeLayers(const vector<LedSourceLayer> &layers,
+                                                const LedLayout &layout)
+{
+    ChannelsToPix output;
+    bool hasBase = false;
+    for (const auto &layer : layers) {
+        ChannelsToPix sampled;
+        if (layer.texture != nullptr)
+            sampled = samplePixels(*layer.texture, layout);
+        else if (layer.pixels != nullptr)
+            sampled = samplePixels(*layer.pixels, layout);
+        else
+            continue;
+
+        if (!hasBase) {
+            /// base goes through same opacity scaling as other layers, merged onto black
+            output = ChannelsToPix(sampled.size());
+            for (size_t chan = 0; chan < sampled.size(); ++chan)
+                output[chan].assign(sampled[chan].size(), 0);
+            hasBase = true;
+            CompositeLayer(output, sampled, LED_MERGE_ALPHA, layer.opacity);
+            continue;
+        }
+        CompositeLayer(output, sampled, m_mergeMode, layer.opacity);
+    }
+    return output;
+}
+
+/// Check send toggle and fps, open sockets for the frame
+bool ofxLedController::beginFrame()
+{
+    if (!m_bSend) {
+        releaseIfIdle();
+        return false;
+    }
+
+    /// frames keep fixed period from schedule instead of from last send,
+    /// after stall schedule restarts from now instead of sending burst
+    auto now = ofGetElapsedTimeMicros();
+    if (now < m_nextFrameTime)
+        return false;
+    m_nextFrameTime += m_usecInFrame;
+    if (m_nextFrameTime <= now)
+        m_nextFrameTime = now + m_usecInFrame;
+
+    m_lastFrameTime = ofGetSystemTimeMillis();
+    activateResources();
+    return true;
+}
+
+void ofxLedController::sendFrame(ChannelsToPix &&grabbedPixs)
+{
+    bool status;
+    {
+        auto lock = lockOutput();
+        /// limit last, on bytes that go to output, with current model of its LED type
+        m_powerLimiter.apply(grabbedPixs, GetLedCurrentModel(LedOutputGetLedType(m_ledOut)));
+        if (m_recorder)
+            m_recorder->push(grabbedPixs, ofGetElapsedTimeMicros());
+        status = LedOutputSend(m_ledOut, move(grabbedPixs));
+    }
+    if (m_statusOk.exchange(status) != status)
+        m_bStatusChanged = true;
+}
+
+bool ofxLedController::startRecording(const string &path)
+{
+    stopRecording();
+    auto recorder = make_unique<ofxLedCaptureWriter>();
+    if (!recorder->open(path, m_id))
+        return false;
+    auto lock = lockOutput();
+    m_recorder = move(recorder);
+    m_bRecording = true;
+    return true;
+}
+
+void ofxLedController::stopRecording()
+{
+    unique_ptr<ofxLedCaptureWriter> recorder;
+    {
+        auto lock = lockOutput();
+        recorder = move(m_recorder);
+        m_bRecording = false;
+    }
+    /// writer finishes queued frames without holding output
+    recorder.reset();
+}
 
-    m_statusOk = LedOutputSend(m_ledOut, move(grabbedPixs));
+bool ofxLedController::startPlayback(const string &path, bool loop, uint64_t startTime)
+{
+    auto player = make_unique<ofxLedCaptureReader>();
+    if (!player->open(path))
+        return false;
+    if (player->getNumFrames() == 0) {
+        ofLogError() << "[ofxLedController] No frames in capture=" << path;
+        return false;
+    }
+    if (player->getControllerId() != m_id)
+        ofLogWarning() << "[ofxLedController] Capture=" << path << " of controller "
+                       << player->getControllerId() << " is played by controller " << m_id;
+
+    /// output thread switches from interpolation to playback
+    stopPlayback();
+    stopOutputThread();
+    m_interpolator.clear();
+
+    m_player = move(player);
+    m_playIndex = std::numeric_limits<size_t>::max();
+    m_bPlayLoop = loop;
+    m_playStart = startTime != 0 ? startTime : ofGetElapsedTimeMicros();
+    activateResources();
+    m_bPlaying = true;
+    startOutputThread();
+    return true;
+}
 
-    if (m_statusOk != prevStatus && m_statusChanged != nullptr)
+void ofxLedController::stopPlayback()
+{
+    if (!m_bPlaying)
+        return;
+    stopOutputThread();
+    m_bPlaying = false;
+    m_player.reset();
+    /// idle time counts from end of playback, next send restarts output thread if needed
+    m_lastFrameTime = ofGetSystemTimeMillis();
+}
+
+void ofxLedController::seekPlayback(uint64_t time)
+{
+    auto now = ofGetElapsedTimeMicros();
+    m_playStart = now - std::min(time, now);
+}
+
+/// Frames keep recorded timing, output thread period only limits how often they are checked
+void ofxLedController::playbackFrame()
+{
+    auto now = ofGetElapsedTimeMicros();
+    uint64_t start = m_playStart;
+    uint64_t time = now > start ? now - start : 0;
+    auto length = m_player->getLoopLength();
+    if (m_bPlayLoop && length > 0)
+        time %= length;
+
+    auto index = m_player->findFrame(time, m_playIndex);
+    if (index == m_playIndex)
+        return;
+    m_playIndex = index;
+    ChannelsToPix pixels;
+    m_player->readFrame(index, pixels);
+    sendFrame(move(pixels));
+}
+
+void ofxLedController::notifyStatusChange()
+{
+    if (m_bStatusChanged.exchange(false) && m_statusChanged != nullptr)
         m_statusChanged();
 }
 
-/// Update grab points from grab objects and put them to VBO
+void ofxLedController::pushFrame(ChannelsToPix &&pixels, LedLayoutPtr layout)
+{
+    m_lastFrameTime = ofGetSystemTimeMillis();
+    activateResources();
+    m_interpolator.push(move(pixels), move(layout), ofGetElapsedTimeMicros());
+    startOutputThread();
+    notifyStatusChange();
+}
+
+/// Thread is started and stopped from send, setInterpolation can be called from gui callback
+/// while output is locked and thread can't be joined there
+void ofxLedController::setInterpolation(LedInterpolation mode)
+{
+    if (mode == m_interpolation)
+        return;
+    m_interpolator.setMode(mode);
+    m_interpolation = mode;
+    markSettingsChanged();
+}
+
+/// dither and output are owned by one thread at a time, stop output thread before
+/// main thread sends without interpolation. With send off thread stops too, otherwise
+/// it keeps repeating last frame, next pushed frame starts it again
+void ofxLedController::updateOutputThread()
+{
+    bool isNeeded = m_interpolation != LED_INTERPOLATION_OFF && m_bSend;
+    if (!isNeeded && m_outputThread.joinable()) {
+        stopOutputThread();
+        m_interpolator.clear();
+    }
+}
+
+void ofxLedController::startOutputThread()
+{
+    if (m_outputThread.joinable())
+        return;
+    m_bThreadExit = false;
+    m_outputThread = std::thread(&ofxLedController::outputThreadFunction, this);
+}
+
+void ofxLedController::stopOutputThread()
+{
+    if (!m_outputThread.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(m_threadMutex);
+        m_bThreadExit = true;
+    }
+    m_threadCondition.notify_one();
+    m_outputThread.join();
+}
+
+/// Send interpolated or played back frame every controller frame period
+void ofxLedController::outputThreadFunction()
+{
+    using Clock = std::chrono::steady_clock;
+    auto nextFrame = Clock::now();
+    std::unique_lock<std::mutex> lock(m_threadMutex);
+    while (true) {
+        auto period = std::chrono::microseconds(m_usecInFrame.load());
+        nextFrame += period;
+        if (nextFrame <= Clock::now())
+            nextFrame = Clock::now() + period;
+        if (m_threadCondition.wait_until(lock, nextFrame, [this] { return m_bThreadExit; }))
+            return;
+
+        lock.unlock();
+        ChannelsToPix pixels;
+        LedLayoutPtr layout;
+        if (m_bPlaying)
+            playbackFrame();
+        else if (m_interpolation != LED_INTERPOLATION_OFF
+                 && m_interpolator.sample(ofGetElapsedTimeMicros(), pixels, layout)) {
+            processPixels(*layout, pixels);
+            sendFrame(move(pixels));
+        }
+        lock.lock();
+    }
+}
+
+/// Compile grab points into new layout snapshot and publish it,
+/// output keeps reading previous snapshot until it finishes its frame
 void ofxLedController::updateGrabPoints()
 {
-    if (!m_bDirtyPoints)
+    if (!m_bDirtyPoints && !m_bDirtyLayout)
         return;
 
     m_bDirtyPoints = false;
-    m_totalLeds = 0;
-    m_ledPoints.clear();
-
-    m_vboLeds.clear();
-    m_vboLeds.setMode(OF_PRIMITIVE_POINTS);
-    m_vboLeds.setUsage(GL_DYNAMIC_DRAW);
+    m_bDirtyLayout = false;
+    auto layout = make_shared<LedLayout>();
+    layout->revision = m_layoutRevision;
+    /// grabs with same correction share LUT
+    vector<pair<LedColorCorrection, LedColorLutPtr>> luts;
+    layout->channelsTotalLeds.assign(m_channelGrabObjects.size(), 0);
+
+    size_t totalPoints = 0;
+    for (auto &channelGrabs : m_channelGrabObjects)
+        for (auto handle : channelGrabs)
+            totalPoints += m_grabPool[handle]->points().size();
+    layout->points.reserve(totalPoints);
 
     for (size_t i = 0; i < m_channelGrabObjects.size(); ++i) {
-        m_channelsTotalLeds[i] = 0;
-        for (auto &object : m_channelGrabObjects[i]) {
-            auto grabPoints = object->getLedPoints();
-            if (m_channelsTotalLeds[i] + grabPoints.size() > m_maxPixInChannel)
+        auto &channelLeds = layout->channelsTotalLeds[i];
+        unsigned int grabId = 0;
+        for (auto handle : m_channelGrabObjects[i]) {
+            auto object = m_grabPool[handle];
+            /// ids follow wiring order, renumbered here instead of on every delete
+            object->setObjectId(grabId++);
+            const auto &grabPoints = object->points();
+            if (channelLeds + grabPoints.size() > m_maxPixInChannel)
                 break;
 
-            m_channelsTotalLeds[i] += grabPoints.size();
-            m_ledPoints.reserve(m_ledPoints.size() + grabPoints.size());
-            m_vboLeds.addVertices(grabPoints);
-
-            std::move(grabPoints.begin(), grabPoints.end(), std::back_inserter(m_ledPoints));
+            channelLeds += grabPoints.size();
+            LedGrid grid;
+            if (m_bCpuGather && object->getType() == LMGrabType::GRAB_MATRIX
+                && static_cast<const ofxLedGrabMatrix *>(object)->getGrid(grid)) {
+                auto firstLed = static_cast<uint32_t>(layout->points.size());
+                layout->grids.push_back(CompileLayoutGrid(grid, firstLed));
+            }
+            if (auto correction = object->getColorCorrection()) {
+                auto it = find_if(luts.begin(), luts.end(), [correction](const auto &lut) {
+                    return lut.first == *correction;
+                });
+                if (it == luts.end())
+                    it = luts.emplace(luts.end(), *correction,
+                                      make_shared<ofxLedColorLut>(*correction, m_colorType));
+                layout->corrections.push_back({ static_cast<uint32_t>(layout->points.size()),
+                                                static_cast<uint32_t>(grabPoints.size()),
+                                                it->second });
+            }
+            for (const auto &point : grabPoints)
+                layout->points.emplace_back(point.x, point.y, 0.f);
         }
-        m_totalLeds += m_channelsTotalLeds[i];
+        layout->totalLeds += channelLeds;
     }
 
     /// set minimal bounds
     ofVec2f res(100.f, 100.f);
-    for_each(m_ledPoints.begin(), m_ledPoints.end(), [&res](const auto &p1) {
+    for_each(layout->points.begin(), layout->points.end(), [&res](const auto &p1) {
         if (res.x < p1.x)
             res.x = p1.x;
         if (res.y < p1.y)
             res.y = p1.y;
     });
     m_grabBounds.set(0, 0, res.x + 1, res.y + 1);
+
+    if (m_bCpuGather)
+        CompileLayoutSamples(*layout);
+    std::atomic_store(&m_layout, LedLayoutPtr(move(layout)));
+}
+
+/// Put snapshot points to VBO, skipped when this revision is already uploaded
+void ofxLedController::uploadLayout(const LedLayout &layout)
+{
+    if (layout.revision == m_uploadedRevision)
+        return;
+
+    m_uploadedRevision = layout.revision;
+    m_vboLeds.clear();
+    m_vboLeds.setMode(OF_PRIMITIVE_POINTS);
+    m_vboLeds.setUsage(GL_DYNAMIC_DRAW);
+    /// upload all points at once
+    m_vboLeds.addVertices(layout.points);
+}
+
+/// Grab texIn pixels in points positions and apply color correction,
+/// counts as frame for idle release, so sampling resources stay while it's called
+ChannelsToPix ofxLedController::updatePixels(const ofTexture &texIn)
+{
+    m_lastFrameTime = ofGetSystemTimeMillis();
+    activateResources();
+    /// hold snapshot for the whole frame, editor may publish new one meanwhile
+    auto layout = peekLayout();
+    auto output = samplePixels(texIn, *layout);
+    processPixels(*layout, output);
+    return output;
+}
+
+/// Sample pixels at LED positions on CPU, in Morton order when layout has sample table
+ChannelsToPix ofxLedController::updatePixels(const ofPixels &pixIn)
+{
+    m_lastFrameTime = ofGetSystemTimeMillis();
+    activateResources();
+    auto layout = peekLayout();
+    auto output = samplePixels(pixIn, *layout);
+    processPixels(*layout, output);
+    return output;
 }
 
 /// Update color for grab points, draw vbo mesh of points, grab texIn pixels in points positions
 /// put grabbed in fbo by mesh vertex id
-ChannelsToPix ofxLedController::updatePixels(const ofTexture &texIn)
+ChannelsToPix ofxLedController::samplePixels(const ofTexture &texIn, const LedLayout &layout)
 {
+    uploadLayout(layout);
+    allocateGrabFbo();
+
     m_fboLeds.begin();
     ofClear(0, 0, 0, 255);
 
@@ -261,13 +784,13 @@ ChannelsToPix ofxLedController::updatePixels(const ofTexture &texIn)
 
     m_fboLeds.readToPixels(m_pixels);
 
-    ChannelsToPix output(m_channelsTotalLeds.size());
+    ChannelsToPix output(layout.channelsTotalLeds.size());
 
     size_t ledsOffset = 0;
     size_t ledChannel = 0;
 
     /// Pack grabbed pixels from texture to channels
-    for (auto ledsInChan : m_channelsTotalLeds) {
+    for (auto ledsInChan : layout.channelsTotalLeds) {
         ledsInChan *= 3; // for GL_RGB
         ledsInChan
             = ledsOffset + ledsInChan < m_pixels.size() ? ledsInChan : m_pixels.size() - ledsOffset;
@@ -283,6 +806,17 @@ ChannelsToPix ofxLedController::updatePixels(const ofTexture &texIn)
     return output;
 }
 
+ChannelsToPix ofxLedController::samplePixels(const ofPixels &pixIn, const LedLayout &layout)
+{
+    return GatherLayoutPixels(layout, pixIn, m_colorType, m_gatherLeds);
+}
+
+void ofxLedController::processPixels(const LedLayout &layout, ChannelsToPix &pixels)
+{
+    m_smoothing.apply(layout, pixels, ofGetElapsedTimeMicros());
+    ApplyColorCorrection(layout, *std::atomic_load(&m_colorLut), pixels, getActiveDither());
+}
+
 /// Make controllers grab objects highligted and editable
 void ofxLedController::setSelected(bool state)
 {
@@ -291,99 +825,369 @@ void ofxLedController::setSelected(bool state)
 
     m_bSelected = state;
     for (auto &channelGrabs : m_channelGrabObjects)
-        for (auto &grab : channelGrabs)
-            grab->setActive(m_bSelected);
+        for (auto handle : channelGrabs)
+            m_grabPool[handle]->setActive(m_bSelected);
 }
 
 void ofxLedController::setGrabsSelected(bool state)
 {
     for (auto &channelGrabs : m_channelGrabObjects)
-        for (auto &grab : channelGrabs)
-            grab->setSelected(state);
+        for (auto handle : channelGrabs)
+            m_grabPool[handle]->setSelected(state);
 }
 
 void ofxLedController::setFps(float fps)
 {
     m_fps = fps;
-    m_msecInFrame = 1000 / m_fps;
+    m_usecInFrame = 1000000 / std::max(m_fps, 1);
+    markSettingsChanged();
+    if (getActiveDither() == nullptr && m_bDither)
+        ofLogWarning() << "[ofxLedController] Dithering needs at least " << s_minDitherFps
+                       << " fps, controller " << m_id << " sends " << m_fps;
 }
 
 //
 // --- Load & Save ---
 //
-void ofxLedController::save(const string &path)
+ofJson ofxLedController::getSettingsJson()
 {
     ofJson config;
     config["colorType"] = s_grabColorTypes[m_colorType];
+    config["colorCorrection"] = m_colorCorrection.toJson();
     config["pixInLed"] = m_pixelsInLed;
     config["fps"] = m_fps;
+    config["bDither"] = m_bDither;
+    config["interpolation"] = m_interpolation.load();
+    config["smoothing"] = m_smoothing.toJson();
+    config["powerLimit"] = m_powerLimiter.toJson();
+    config["mergeMode"] = m_mergeMode.load();
+    config["source"] = m_source;
     config["bSend"] = m_bSend;
+    config["idleReleaseMs"] = m_idleReleaseTime;
     config["outputType"] = GetLedOutputType(m_ledOut);
     LedOutputSave(m_ledOut, config);
+    return config;
+}
 
-    ofJson grabs_array = ofJson::array();
-    for (auto &channelGrabs : m_channelGrabObjects)
-        for (auto &grab : channelGrabs)
-            grabs_array.emplace_back(grab);
+void ofxLedController::save(const string &path)
+{
+    if (!ofxLedConfigSaver::WriteJson(path, getConfigSnapshot()))
+        return;
+    markConfigSaved();
+
+    ofLogNotice() << "[ofxLedController] Save config to " << path << LCFileName << m_id << ".json";
+}
+
+/// Copy of settings and grabs for saving from another thread
+LedControllerConfig ofxLedController::getConfigSnapshot()
+{
+    LedControllerConfig config;
+    config.id = m_id;
+    config.outputType = GetLedOutputType(m_ledOut);
+    config.settings = getSettingsJson();
+    config.grabPool.reserve(m_grabPool.size());
+    config.channelGrabObjects.resize(m_channelGrabObjects.size());
+    for (size_t chan = 0; chan < m_channelGrabObjects.size(); ++chan) {
+        config.channelGrabObjects[chan].reserve(m_channelGrabObjects[chan].size());
+        for (auto handle : m_channelGrabObjects[chan])
+            config.channelGrabObjects[chan].emplace_back(
+                config.grabPool.clone(*m_grabPool[handle]));
+    }
+    return config;
+}
 
-    if (!grabs_array.empty())
-        config["grabs"] = grabs_array;
+shared_ptr<const LedControllerConfig> ofxLedController::getSharedConfigSnapshot()
+{
+    if (m_configSnapshot == nullptr || m_snapshotLayoutRevision != m_layoutRevision
+        || m_snapshotSettingsRevision != m_settingsRevision) {
+        m_configSnapshot = make_shared<LedControllerConfig>(getConfigSnapshot());
+        m_snapshotLayoutRevision = m_layoutRevision;
+        m_snapshotSettingsRevision = m_settingsRevision;
+    }
+    return m_configSnapshot;
+}
 
-    ofstream jsonFile(path + LCFileName + ofToString(m_id) + ".json");
-    jsonFile << config.dump(4);
-    jsonFile.close();
+bool ofxLedController::isConfigDirty() const
+{
+    return m_layoutRevision != m_savedLayoutRevision
+           || m_settingsRevision != m_savedSettingsRevision;
+}
 
-    ofLogNotice() << "[ofxLedController] Save config to " << path << LCFileName << m_id << ".json";
+void ofxLedController::markConfigSaved()
+{
+    m_savedLayoutRevision = m_layoutRevision;
+    m_savedSettingsRevision = m_settingsRevision;
 }
 
 void ofxLedController::load(const string &path)
 {
-    m_channelGrabObjects.clear();
-    m_channelGrabObjects.resize(m_channelList.size());
+    applyConfig(ReadConfig(m_id, GetLedOutputType(m_ledOut), path));
+}
+
+/// Read json (or deprecated xml) config and create grabs with their points,
+/// touches no GL or network resources
+LedControllerConfig ofxLedController::ReadConfig(unsigned int id, LedOutputType outputType,
+                                                 const string &path)
+{
+    LedControllerConfig config;
+    config.id = id;
+    config.outputType = outputType;
+
+    auto filePath = ofFilePath::addTrailingSlash(path) + LCFileName + ofToString(id);
+    ofJson json;
+    vector<LedGrabDesc> descs;
+    ParseJsonToGrabDescs(filePath + ".json", json, descs);
+
+    /// channels of output type from config to validate grabs
+    if (json.contains("outputType"))
+        config.outputType = json.at("outputType").get<LedOutputType>();
+    auto output = CreateLedOutput(config.outputType);
+    config.channelGrabObjects.resize(LedOutputGetChannels(output).size());
 
-    auto json
-        = ofLoadJson(ofFilePath::addTrailingSlash(path) + LCFileName + ofToString(m_id) + ".json");
     if (json.empty()) {
         /// fallback for older XML config
-        if (!ParseXmlToGrabObjects(ofFilePath::addTrailingSlash(path) + LCFileName
-                                       + ofToString(m_id) + ".xml",
-                                   m_channelGrabObjects, json))
-            return;
+        if (!ParseXmlToGrabObjects(filePath + ".xml", config.grabPool, config.channelGrabObjects,
+                                   json))
+            return config;
     }
 
-    LedOutputType outputType = json.contains("outputType")
-                                   ? json.at("outputType").get<LedOutputType>()
-                                   : LedOutputTypeLedmap;
-    m_ledOut = CreateLedOutput(outputType);
+    float pixelsInLed = json.count("pixInLed") ? json.at("pixInLed").get<float>() : 2.0;
+
+    /// points are generated once with final pixels in led
+    config.grabPool.reserve(descs.size());
+    for (const auto &desc : descs) {
+        if (desc.channel < 0
+            || static_cast<size_t>(desc.channel) >= config.channelGrabObjects.size())
+            continue;
+        auto handle = config.grabPool.create(desc, pixelsInLed);
+        if (!handle.isValid())
+            continue;
+        auto &channelGrabs = config.channelGrabObjects[desc.channel];
+        config.grabPool[handle]->setObjectId(channelGrabs.size());
+        channelGrabs.emplace_back(handle);
+    }
+
+    config.settings = move(json);
+    return config;
+}
+
+/// Apply prepared config: create output and GL resources, take grabs
+void ofxLedController::applyConfig(LedControllerConfig &&config)
+{
+    resetHistory();
+    m_channelGrabObjects.clear();
+    m_grabPool.clear();
+
+    setOutputType(config.outputType);
+
+    m_grabPool = move(config.grabPool);
+    m_channelGrabObjects = move(config.channelGrabObjects);
+    m_channelGrabObjects.resize(m_channelList.size());
+    setCurrentChannel(m_currentChannelNum);
+    markDirtyGrabPoints();
+
+    const auto &json = config.settings;
+    if (json.empty())
+        return;
+
     LedOutputLoad(m_ledOut, json);
 
     setColorType(GetColorType(json.count("colorType") ? json.at("colorType").get<string>() : ""));
+    LedColorCorrection correction;
+    correction.fromJson(json.count("colorCorrection") ? json.at("colorCorrection") : ofJson());
+    setColorCorrection(correction);
 
     m_pixelsInLed = json.count("pixInLed") ? json.at("pixInLed").get<float>() : 2.0;
-    m_fps = json.count("fps") ? json.at("fps").get<int>() : 25;
+    setDithering(json.count("bDither") ? json.at("bDither").get<bool>() : false);
+    setInterpolation(json.count("interpolation") ? json.at("interpolation").get<LedInterpolation>()
+                                                 : LED_INTERPOLATION_OFF);
+    m_smoothing.fromJson(json.count("smoothing") ? json.at("smoothing") : ofJson());
+    m_powerLimiter.fromJson(json.count("powerLimit") ? json.at("powerLimit") : ofJson());
+    m_mergeMode
+        = json.count("mergeMode") ? json.at("mergeMode").get<LedMergeMode>() : LED_MERGE_HTP;
+    m_source = json.count("source") ? json.at("source").get<string>() : "";
+    setFps(json.count("fps") ? json.at("fps").get<int>() : 25);
     m_bSend = json.count("bSend") ? json.at("bSend").get<bool>() : false;
+    m_idleReleaseTime = json.count("idleReleaseMs") ? json.at("idleReleaseMs").get<uint64_t>()
+                                                     : s_defaultIdleReleaseTime;
+    markSettingsChanged();
 
-    if (!json.count("grabs") || !json.at("grabs").is_array())
-        return;
-    ofLogNotice() << json.dump();
-    vector<unique_ptr<ofxLedGrab>> jsonGrabs;
-    jsonGrabs = json.at("grabs").get<vector<unique_ptr<ofxLedGrab>>>();
-    jsonGrabs.erase(std::remove_if(jsonGrabs.begin(), jsonGrabs.end(),
-                                   [](unique_ptr<ofxLedGrab> &grab) { return grab == nullptr; }),
-                    jsonGrabs.end());
+    updateGrabPoints();
 
-    unordered_map<size_t, size_t> chanIdCntr;
-    for (auto &grab : jsonGrabs) {
-        auto chan = grab->getChannel();
-        if (chan >= m_channelList.size())
-            continue;
-        grab->setPixelsInLed(m_pixelsInLed);
-        grab->setObjectId(chanIdCntr[chan]++);
-        m_channelGrabObjects[chan].emplace_back(move(grab));
+    /// config matches file it was read from
+    markConfigSaved();
+}
+
+/// Apply reloaded config keeping unchanged grabs and output connection,
+/// returns true if anything changed
+bool ofxLedController::applyConfigDiff(LedControllerConfig &&config)
+{
+    if (config.outputType != GetLedOutputType(m_ledOut) || config.settings.empty()) {
+        applyConfig(move(config));
+        return true;
     }
 
-    markDirtyGrabPoints();
-    updateGrabPoints();
+    bool changed = false;
+    auto current = getSettingsJson();
+    auto json = current;
+    json.update(config.settings);
+
+    if (json != current) {
+        changed = true;
+
+        /// reconnect output only when its own settings changed
+        ofJson outputCurrent;
+        LedOutputSave(m_ledOut, outputCurrent);
+        bool outputChanged = false;
+        for (const auto &item : outputCurrent.items())
+            outputChanged |= json.at(item.key()) != item.value();
+        if (outputChanged) {
+            auto lock = lockOutput();
+            LedOutputLoad(m_ledOut, json);
+            if (m_bResourcesActive)
+                LedOutputResetup(m_ledOut);
+        }
+
+        setColorType(GetColorType(json.at("colorType").get<string>()));
+        LedColorCorrection correction;
+        correction.fromJson(json.at("colorCorrection"));
+        setColorCorrection(correction);
+        setDithering(json.at("bDither").get<bool>());
+        setInterpolation(json.at("interpolation").get<LedInterpolation>());
+        m_smoothing.fromJson(json.at("smoothing"));
+        m_powerLimiter.fromJson(json.at("powerLimit"));
+        m_mergeMode = json.at("mergeMode").get<LedMergeMode>();
+        m_source = json.at("source").get<string>();
+        setFps(json.at("fps").get<int>());
+        m_bSend = json.at("bSend").get<bool>();
+        m_idleReleaseTime = json.at("idleReleaseMs").get<uint64_t>();
+        if (json.at("pixInLed").get<float>() != m_pixelsInLed)
+            setPixInLed(json.at("pixInLed").get<float>());
+        markSettingsChanged();
+    }
+
+    /// replace only grabs that differ at same wiring position
+    auto &grabs = config.channelGrabObjects;
+    grabs.resize(m_channelGrabObjects.size());
+    for (size_t chan = 0; chan < m_channelGrabObjects.size(); ++chan) {
+        auto &channelGrabs = m_channelGrabObjects[chan];
+        for (size_t i = 0; i < grabs[chan].size(); ++i) {
+            auto grab = config.grabPool[grabs[chan][i]];
+            if (i < channelGrabs.size() && m_grabPool[channelGrabs[i]]->toDesc() == grab->toDesc())
+                continue;
+
+            auto handle = m_grabPool.clone(*grab);
+            m_grabPool[handle]->setActive(m_bSelected);
+            if (i < channelGrabs.size()) {
+                m_grabPool.destroy(channelGrabs[i]);
+                channelGrabs[i] = handle;
+            }
+            else {
+                channelGrabs.emplace_back(handle);
+            }
+            changed = true;
+        }
+        for (size_t i = grabs[chan].size(); i < channelGrabs.size(); ++i) {
+            m_grabPool.destroy(channelGrabs[i]);
+            changed = true;
+        }
+        channelGrabs.resize(grabs[chan].size());
+    }
+
+    if (changed) {
+        /// recorded positions don't match reloaded layout
+        resetHistory();
+        markDirtyGrabPoints();
+        updateGrabPoints();
+    }
+    markConfigSaved();
+    return changed;
+}
+
+/// Create output, channels and grab FBO sized for output max pixels
+void ofxLedController::setOutputType(LedOutputType outputType)
+{
+    /// FBO size and sockets depend on output, recreated on next send
+    releaseResources();
+    m_ledOut = CreateLedOutput(outputType);
+    m_channelList = LedOutputGetChannels(m_ledOut);
+    auto maxPixelsOut = LedOutputGetMaxPixels(m_ledOut);
+    m_maxPixInChannel = maxPixelsOut / m_channelList.size();
+
+    /// drop grabs from channels output doesn't have
+    for (size_t chan = m_channelList.size(); chan < m_channelGrabObjects.size(); ++chan)
+        for (auto handle : m_channelGrabObjects[chan])
+            m_grabPool.destroy(handle);
+    m_channelGrabObjects.resize(m_channelList.size());
+    setCurrentChannel(m_currentChannelNum);
+}
+
+/// Open output sockets on first enabled send
+void ofxLedController::activateResources()
+{
+    if (m_bResourcesActive)
+        return;
+
+    m_bResourcesActive = true;
+    LedOutputResetup(m_ledOut);
+    ofLogVerbose() << "[ofxLedController] Activate controller " << m_id;
+}
+
+/// Allocate FBO and compile shader on first frame grabbed from texture,
+/// controllers sent with ofPixels never create them
+void ofxLedController::allocateGrabFbo()
+{
+    if (m_fboLeds.isAllocated())
+        return;
+
+    auto startTime = ofGetElapsedTimeMicros();
+    m_fboLeds.allocate(500, ceil(LedOutputGetMaxPixels(m_ledOut) / 500.f), GL_RGB);
+    m_fboLeds.begin();
+    ofClear(0, 0, 0, 255);
+    m_fboLeds.end();
+
+    m_shaderGrab = GetShaderForColorGrab(m_colorType);
+
+    ofLogVerbose() << "[ofxLedController] Allocate grab FBO of controller " << m_id << " in "
+                   << (ofGetElapsedTimeMicros() - startTime) / 1000.f << "ms";
+}
+
+/// Free GL resources, sockets and pixel buffers, they are recreated on next send
+void ofxLedController::releaseResources()
+{
+    stopPlayback();
+    stopOutputThread();
+    if (!m_bResourcesActive)
+        return;
+
+    m_bResourcesActive = false;
+    m_fboLeds.clear();
+    m_shaderGrab.unload();
+    m_pixels.clear();
+    m_gatherLeds = vector<char>();
+    LedOutputRelease(m_ledOut);
+
+    bool prevStatus = m_statusOk;
+    m_statusOk = false;
+    if (prevStatus && m_statusChanged != nullptr)
+        m_statusChanged();
+
+    ofLogVerbose() << "[ofxLedController] Release resources of idle controller " << m_id;
+}
+
+/// Release resources when nothing was sent for longer than idle time
+void ofxLedController::releaseIfIdle()
+{
+    if (!m_bResourcesActive || m_idleReleaseTime == 0 || m_bPlaying)
+        return;
+    if (ofGetSystemTimeMillis() - m_lastFrameTime > m_idleReleaseTime)
+        releaseResources();
+}
+
+void ofxLedController::setIdleReleaseTime(uint64_t msec)
+{
+    m_idleReleaseTime = msec;
+    markSettingsChanged();
 }
 
 //
@@ -395,30 +1199,55 @@ void ofxLedController::mousePressed(ofMouseEventArgs &args)
         return;
 
     /// don't add grabs if pressed into existing
-    if (std::count_if(begin(*m_currentChannel), end(*m_currentChannel),
-                      [&args](const auto &grab) { return grab->mousePressed(args); }))
+    auto pressed = [this, &args](auto handle) { return m_grabPool[handle]->mousePressed(args); };
+    bool pressedExisting
+        = std::count_if(begin(*m_currentChannel), end(*m_currentChannel), pressed) > 0;
+    beginGesture();
+    if (pressedExisting) {
+        m_openPath = {};
         return;
+    }
 
     switch (m_currentGrabType) {
         case LMGrabType::GRAB_EMPTY:
         case LMGrabType::GRAB_SELECT:
+        case LMGrabType::GRAB_POINTS:
             /// set position of selection rectangle
             m_selectionRect.set(args, 0, 0);
             break;
+        case LMGrabType::GRAB_PATH: {
+            /// first press starts path with dragged segment, next ones add points to it,
+            /// press on existing grab, Enter or other tool finishes path
+            auto path = static_cast<ofxLedGrabPath *>(m_grabPool.get(m_openPath));
+            if (path == nullptr || m_currentChannel->empty()
+                || m_currentChannel->back() != m_openPath) {
+                setGrabsSelected(false);
+                m_openPath = addGrab<ofxLedGrabPath>(vector<ofVec2f>{ args }, m_pixelsInLed);
+                path = static_cast<ofxLedGrabPath *>(m_grabPool[m_openPath]);
+            }
+            else {
+                /// press outside deselected path, record it for undo of added point
+                path->setSelected(true);
+                m_gesture.before.emplace_back(m_currentChannel->size() - 1, path->toDesc());
+            }
+            path->addControlPoint(args);
+            markDirtyGrabPoints();
+            break;
+        }
         case LMGrabType::GRAB_LINE: {
             /// deselect previous active grabs
             setGrabsSelected(false);
-            addGrab(make_unique<ofxLedGrabLine>(args, args, m_pixelsInLed));
+            addGrab<ofxLedGrabLine>(args, args, m_pixelsInLed);
             break;
         }
         case LMGrabType::GRAB_MATRIX: {
             setGrabsSelected(false);
-            addGrab(make_unique<ofxLedGrabMatrix>(args, args, m_pixelsInLed));
+            addGrab<ofxLedGrabMatrix>(args, args, m_pixelsInLed);
             break;
         }
         case LMGrabType::GRAB_CIRCLE: {
             setGrabsSelected(false);
-            addGrab(make_unique<ofxLedGrabCircle>(args, args, m_pixelsInLed));
+            addGrab<ofxLedGrabCircle>(args, args, m_pixelsInLed);
             break;
         }
     }
@@ -429,8 +1258,8 @@ void ofxLedController::mouseDragged(ofMouseEventArgs &args)
     if (!m_bSelected || m_currentChannel->empty())
         return;
 
-    if (std::count_if(begin(*m_currentChannel), end(*m_currentChannel),
-                      [&args](const auto &grab) { return grab->mouseDragged(args); })) {
+    auto dragged = [this, &args](auto handle) { return m_grabPool[handle]->mouseDragged(args); };
+    if (std::count_if(begin(*m_currentChannel), end(*m_currentChannel), dragged)) {
         markDirtyGrabPoints();
     }
     else {
@@ -440,26 +1269,40 @@ void ofxLedController::mouseDragged(ofMouseEventArgs &args)
 
 void ofxLedController::mouseReleased(ofMouseEventArgs &args)
 {
-    if (m_currentChannel->empty())
+    if (m_currentChannel->empty()) {
+        endGesture();
         return;
+    }
 
     if (!m_selectionRect.isEmpty()) {
-        std::for_each(begin(*m_currentChannel), end(*m_currentChannel), [this](const auto &grab) {
+        std::for_each(begin(*m_currentChannel), end(*m_currentChannel), [this](auto handle) {
+            auto grab = m_grabPool[handle];
             if (m_selectionRect.intersects(grab->getFrom(), grab->getTo()))
                 grab->setSelected(true);
         });
         m_selectionRect.set(0, 0, 0, 0);
+        endGesture();
         return;
     }
 
     /// delete zero length grab, that was created with one click - not counted
-    if (m_currentChannel->back()->points().empty()) {
+    if (m_grabPool[m_currentChannel->back()]->points().empty()) {
+        auto position = m_currentChannel->size() - 1;
+        bool createdNow = m_gesture.active && m_gesture.channel == m_currentChannelNum
+                          && position >= m_gesture.channelSize;
+        if (!createdNow) {
+            endGesture();
+            auto desc = m_grabPool[m_currentChannel->back()]->toDesc();
+            m_history.push({ { m_currentChannelNum, position, { move(desc) }, {} } });
+        }
+        m_grabPool.destroy(m_currentChannel->back());
         m_currentChannel->pop_back();
         markDirtyGrabPoints();
     }
 
     std::count_if(begin(*m_currentChannel), end(*m_currentChannel),
-                  [&args](const auto &grab) { return grab->mouseReleased(args); });
+                  [this, &args](auto handle) { return m_grabPool[handle]->mouseReleased(args); });
+    endGesture();
 }
 
 void ofxLedController::keyPressed(ofKeyEventArgs &data)
@@ -474,6 +1317,12 @@ void ofxLedController::keyPressed(ofKeyEventArgs &data)
         case '3':
             m_currentGrabType = LMGrabType::GRAB_MATRIX;
             break;
+        case '4':
+            setGrabType(LMGrabType::GRAB_PATH);
+            break;
+        case OF_KEY_RETURN:
+            m_openPath = {};
+            break;
         case OF_KEY_BACKSPACE:
             deleteSelectedGrabs();
             break;
@@ -489,62 +1338,370 @@ void ofxLedController::keyReleased(ofKeyEventArgs &data)
 void ofxLedController::setPixInLed(const float pixInled)
 {
     m_pixelsInLed = pixInled;
+    markSettingsChanged();
     for (auto &channelGrabs : m_channelGrabObjects)
-        for (auto &grab : channelGrabs)
-            grab->setPixelsInLed(m_pixelsInLed);
+        for (auto handle : channelGrabs)
+            m_grabPool[handle]->setPixelsInLed(m_pixelsInLed);
 
     /// TODO call only when change objects
     markDirtyGrabPoints();
 }
 
-unique_ptr<ofxLedGrab> ofxLedController::GetUniqueTypedGrab(const ofxLedGrab *grab)
-{
-    switch (grab->getType()) {
-        case LMGrabType::GRAB_LINE:
-            return make_unique<ofxLedGrabLine>(*(dynamic_cast<const ofxLedGrabLine *>(grab)));
-        case LMGrabType::GRAB_MATRIX:
-            return make_unique<ofxLedGrabMatrix>(*(dynamic_cast<const ofxLedGrabMatrix *>(grab)));
-        case LMGrabType::GRAB_CIRCLE:
-            return make_unique<ofxLedGrabCircle>(*(dynamic_cast<const ofxLedGrabCircle *>(grab)));
-        default:
-            break;
-    }
-    assert(false);
-    return nullptr;
-}
-
-void ofxLedController::addGrab(unique_ptr<ofxLedGrab> &&object)
+GrabHandle ofxLedController::addGrab(GrabHandle handle)
 {
+    auto object = m_grabPool[handle];
     object->setObjectId(m_currentChannel->size());
     object->setChannel(m_currentChannelNum);
     object->setActive(true);
     object->setSelected(true);
-    m_currentChannel->emplace_back(move(object));
+    m_currentChannel->emplace_back(handle);
+    markDirtyGrabPoints();
+    /// grabs added by mouse are recorded on release with final size
+    if (!m_gesture.active)
+        m_history.push(
+            { { m_currentChannelNum, m_currentChannel->size() - 1, {}, { object->toDesc() } } });
+    return handle;
+}
+
+bool ofxLedController::addGrabs(const vector<LedGrabDesc> &descs, bool replaceExisting)
+{
+    return addGrabs(vector<LedGrabDesc>(descs), replaceExisting);
+}
+
+/// descriptions are moved into grabs, so big point maps are not copied
+bool ofxLedController::addGrabs(vector<LedGrabDesc> &&descs, bool replaceExisting)
+{
+    vector<GrabHandle> grabs;
+    grabs.reserve(descs.size());
+    m_grabPool.reserve(m_grabPool.size() + descs.size());
+
+    for (auto &desc : descs) {
+        auto type = desc.type;
+        auto handle = m_grabPool.create(move(desc), m_pixelsInLed);
+        if (!handle.isValid()) {
+            ofLogError() << "[ofxLedController] addGrabs: unknown grab type=" << type;
+            for (auto created : grabs)
+                m_grabPool.destroy(created);
+            return false;
+        }
+        grabs.emplace_back(handle);
+    }
+
+    return commitGrabs(grabs, replaceExisting, false);
+}
+
+bool ofxLedController::addGrabs(const vector<const ofxLedGrab *> &grabs, const ofVec2f &offset)
+{
+    vector<GrabHandle> copies;
+    copies.reserve(grabs.size());
+    m_grabPool.reserve(m_grabPool.size() + grabs.size());
+
+    for (auto grab : grabs) {
+        auto handle = m_grabPool.clone(*grab);
+        auto copy = m_grabPool[handle];
+        copy->setChannel(m_currentChannelNum);
+        if (offset != ofVec2f(0))
+            copy->set(copy->getFrom() + offset, copy->getTo() + offset);
+        copies.emplace_back(handle);
+    }
+
+    return commitGrabs(copies, false, true);
+}
+
+bool ofxLedController::importPixelMap(const string &path)
+{
+    vector<LedGrabDesc> descs;
+    if (!ParsePixelMapToGrabDescs(path, m_maxPixInChannel, m_channelList.size(), descs))
+        return false;
+    return addGrabs(move(descs), true);
+}
+
+/// validate created grabs against channels capacity and move them into channels,
+/// on failure grabs are destroyed and layout stays untouched
+bool ofxLedController::commitGrabs(const vector<GrabHandle> &grabs, bool replaceExisting,
+                                   bool select)
+{
+    vector<size_t> channelLeds(m_channelList.size(), 0);
+    if (!replaceExisting) {
+        for (size_t chan = 0; chan < channelLeds.size(); ++chan)
+            channelLeds[chan] = countChannelLeds(chan);
+    }
+
+    string error;
+    for (auto handle : grabs) {
+        auto grab = m_grabPool[handle];
+        auto chan = grab->getChannel();
+        if (chan < 0 || static_cast<size_t>(chan) >= channelLeds.size()) {
+            error = "wrong channel=" + ofToString(chan);
+            break;
+        }
+        channelLeds[chan] += grab->points().size();
+        if (channelLeds[chan] > m_maxPixInChannel) {
+            error = "channel=" + ofToString(chan)
+                    + " exceeds max pixels=" + ofToString(m_maxPixInChannel);
+            break;
+        }
+    }
+
+    if (!error.empty()) {
+        ofLogError() << "[ofxLedController] Controller " << m_id << " reject grabs: " << error;
+        for (auto handle : grabs)
+            m_grabPool.destroy(handle);
+        return false;
+    }
+
+    endGesture();
+    /// one edit per channel: replaced or appended grabs
+    LedGrabEdits edits(m_channelGrabObjects.size());
+    for (size_t chan = 0; chan < edits.size(); ++chan) {
+        edits[chan].channel = chan;
+        edits[chan].position = replaceExisting ? 0 : m_channelGrabObjects[chan].size();
+    }
+
+    if (replaceExisting) {
+        for (size_t chan = 0; chan < m_channelGrabObjects.size(); ++chan) {
+            auto &channelGrabs = m_channelGrabObjects[chan];
+            edits[chan].removed.reserve(channelGrabs.size());
+            for (auto handle : channelGrabs) {
+                edits[chan].removed.emplace_back(m_grabPool[handle]->toDesc());
+                m_grabPool.destroy(handle);
+            }
+            channelGrabs.clear();
+        }
+    }
+
+    for (auto handle : grabs) {
+        auto grab = m_grabPool[handle];
+        auto &channelGrabs = m_channelGrabObjects[grab->getChannel()];
+        grab->setObjectId(channelGrabs.size());
+        grab->setActive(m_bSelected);
+        grab->setSelected(select);
+        channelGrabs.emplace_back(handle);
+        edits[grab->getChannel()].inserted.emplace_back(grab->toDesc());
+    }
+
+    edits.erase(std::remove_if(begin(edits), end(edits),
+                               [](const auto &edit) {
+                                   return edit.removed.empty() && edit.inserted.empty();
+                               }),
+                end(edits));
+    m_history.push(move(edits));
+
     markDirtyGrabPoints();
+    return true;
+}
+
+size_t ofxLedController::countChannelLeds(size_t chan) const
+{
+    size_t leds = 0;
+    for (auto handle : m_channelGrabObjects[chan])
+        leds += m_grabPool[handle]->points().size();
+    return leds;
 }
 
 void ofxLedController::deleteSelectedGrabs()
 {
-    /// remove selected if has
-    auto it = std::remove_if(begin(*m_currentChannel), end(*m_currentChannel),
-                             [](auto &grab) { return grab->isSelected(); });
-    if (it == end(*m_currentChannel))
+    endGesture();
+    /// record removed ranges from the end, so positions stay valid when edits applied in order
+    LedGrabEdits edits;
+    for (size_t i = m_currentChannel->size(); i > 0; --i) {
+        auto grab = m_grabPool[(*m_currentChannel)[i - 1]];
+        if (!grab->isSelected())
+            continue;
+        if (edits.empty() || edits.back().position != i)
+            edits.push_back({ m_currentChannelNum, i, {}, {} });
+        edits.back().position = i - 1;
+        edits.back().removed.emplace_back(grab->toDesc());
+    }
+    if (edits.empty())
         return;
-
+    for (auto &edit : edits)
+        std::reverse(begin(edit.removed), end(edit.removed));
+    m_history.push(move(edits));
+
+    /// remove selected, ids of the rest are updated with grab points.
+    /// destroy in predicate, tail after remove_if holds copies of kept handles
+    auto it = std::remove_if(begin(*m_currentChannel), end(*m_currentChannel), [this](auto handle) {
+        if (!m_grabPool[handle]->isSelected())
+            return false;
+        m_grabPool.destroy(handle);
+        return true;
+    });
     m_currentChannel->erase(it, end(*m_currentChannel));
-    /// update grab ids
-    size_t grabCntr = 0;
-    std::for_each(begin(*m_currentChannel), end(*m_currentChannel),
-                  [&grabCntr](auto &grab) { (*grab).setObjectId(grabCntr++); });
 
     markDirtyGrabPoints();
     return;
 }
 
+//
+// --- Undo / Redo ---
+//
+
+/// remember grabs that can be moved by drag, they are compared with result on release
+void ofxLedController::beginGesture()
+{
+    m_gesture.active = true;
+    m_gesture.channel = m_currentChannelNum;
+    m_gesture.channelSize = m_currentChannel->size();
+    m_gesture.before.clear();
+    for (size_t i = 0; i < m_currentChannel->size(); ++i) {
+        auto grab = m_grabPool[(*m_currentChannel)[i]];
+        if (grab->isSelected())
+            m_gesture.before.emplace_back(i, grab->toDesc());
+    }
+}
+
+/// record grabs changed or added by mouse since beginGesture as one action
+void ofxLedController::endGesture()
+{
+    if (!m_gesture.active)
+        return;
+    m_gesture.active = false;
+
+    const auto chan = m_gesture.channel;
+    const auto &channelGrabs = m_channelGrabObjects[chan];
+    LedGrabEdits edits;
+    for (auto &before : m_gesture.before) {
+        if (before.first >= m_gesture.channelSize || before.first >= channelGrabs.size())
+            continue;
+        auto after = m_grabPool[channelGrabs[before.first]]->toDesc();
+        if (after != before.second)
+            edits.push_back({ chan, before.first, { move(before.second) }, { move(after) } });
+    }
+    m_gesture.before.clear();
+
+    if (channelGrabs.size() > m_gesture.channelSize) {
+        edits.push_back({ chan, m_gesture.channelSize, {}, {} });
+        for (size_t i = m_gesture.channelSize; i < channelGrabs.size(); ++i)
+            edits.back().inserted.emplace_back(m_grabPool[channelGrabs[i]]->toDesc());
+    }
+    m_history.push(move(edits));
+}
+
+/// replace recorded range of grabs, only inserted grabs generate points
+bool ofxLedController::applyEdit(const LedGrabEdit &edit, const vector<LedGrabDesc> &remove,
+                                 const vector<LedGrabDesc> &insert)
+{
+    if (edit.channel >= m_channelGrabObjects.size())
+        return false;
+    auto &channelGrabs = m_channelGrabObjects[edit.channel];
+    if (edit.position + remove.size() > channelGrabs.size())
+        return false;
+
+    vector<GrabHandle> created;
+    created.reserve(insert.size());
+    for (const auto &desc : insert) {
+        auto handle = m_grabPool.create(desc, m_pixelsInLed);
+        if (!handle.isValid())
+            continue;
+        auto grab = m_grabPool[handle];
+        grab->setActive(m_bSelected);
+        grab->setSelected(true);
+        created.emplace_back(handle);
+    }
+
+    auto first = begin(channelGrabs) + edit.position;
+    std::for_each(first, first + remove.size(),
+                  [this](auto handle) { m_grabPool.destroy(handle); });
+    first = channelGrabs.erase(first, first + remove.size());
+    channelGrabs.insert(first, begin(created), end(created));
+    return true;
+}
+
+bool ofxLedController::undo()
+{
+    endGesture();
+    auto edits = m_history.undo();
+    if (edits == nullptr)
+        return false;
+
+    setGrabsSelected(false);
+    bool result = true;
+    for (auto it = edits->rbegin(); it != edits->rend() && result; ++it)
+        result = applyEdit(*it, it->inserted, it->removed);
+    markDirtyGrabPoints();
+
+    if (!result) {
+        ofLogError() << "[ofxLedController] Controller " << m_id
+                     << " undo doesn't match layout, history cleared";
+        m_history.clear();
+    }
+    return result;
+}
+
+bool ofxLedController::redo()
+{
+    endGesture();
+    auto edits = m_history.redo();
+    if (edits == nullptr)
+        return false;
+
+    setGrabsSelected(false);
+    bool result = true;
+    for (auto it = edits->begin(); it != edits->end() && result; ++it)
+        result = applyEdit(*it, it->removed, it->inserted);
+    markDirtyGrabPoints();
+
+    if (!result) {
+        ofLogError() << "[ofxLedController] Controller " << m_id
+                     << " redo doesn't match layout, history cleared";
+        m_history.clear();
+    }
+    return result;
+}
+
+void ofxLedController::resetHistory()
+{
+    m_gesture = EditGesture();
+    m_history.clear();
+}
+
 void ofxLedController::setColorType(GRAB_COLOR_TYPE type)
 {
-    m_colorType = type;
-    m_shaderGrab = GetShaderForColorGrab(m_colorType);
+    /// shader compile is the slowest part of controller setup, skip when type is the same
+    /// or controller doesn't grab texture, shader is compiled in allocateGrabFbo
+    if (type == m_colorType && m_shaderGrab.isLoaded())
+        return;
+    if (type != m_colorType) {
+        m_colorType = type;
+        /// LUTs are built in output color order
+        updateColorLut();
+        m_bDirtyLayout = true;
+        markSettingsChanged();
+    }
+    if (m_fboLeds.isAllocated())
+        m_shaderGrab = GetShaderForColorGrab(m_colorType);
+}
+
+void ofxLedController::setColorCorrection(const LedColorCorrection &correction)
+{
+    if (correction == m_colorCorrection)
+        return;
+    m_colorCorrection = correction;
+    updateColorLut();
+    markSettingsChanged();
+}
+
+void ofxLedController::setDithering(bool state)
+{
+    if (state == m_bDither)
+        return;
+    m_bDither = state;
+    markSettingsChanged();
+    if (m_bDither && getActiveDither() == nullptr)
+        ofLogWarning() << "[ofxLedController] Dithering needs at least " << s_minDitherFps
+                       << " fps, controller " << m_id << " sends " << m_fps;
+}
+
+ofxLedDither *ofxLedController::getActiveDither()
+{
+    return m_bDither && m_fps >= s_minDitherFps ? &m_dither : nullptr;
+}
+
+void ofxLedController::updateColorLut()
+{
+    std::atomic_store(&m_colorLut,
+                      LedColorLutPtr(make_shared<ofxLedColorLut>(m_colorCorrection, m_colorType)));
 }
 
 void ofxLedController::setCurrentChannel(int chan)
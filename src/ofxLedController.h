@@ -24,14 +24,40 @@
 
 #include "Common.h"
 #include "ofMain.h"
-#include "ofxLedGrabObject.h"
+#include "grab/ofxLedGrabHistory.h"
+#include "ofxLedCapture.h"
+#include "grab/ofxLedGrabPool.h"
+#include "ofxLedLayout.h"
+#include "ofxLedPlaylist.h"
 #include "ofxXmlSettings.h"
 #include "output/ofxLedOutput.h"
+#include "process/ofxLedCompositor.h"
+#include "process/ofxLedFrameInterpolator.h"
+#include "process/ofxLedPowerLimiter.h"
+#include "process/ofxLedSmoothing.h"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 namespace LedMapper {
 
 using OnControllerStatusChange = function<void(void)>;
-using ChannelsGrabObjects = vector<vector<unique_ptr<ofxLedGrab>>>;
+
+/// time without sending after controller frees GL resources and sockets
+static const uint64_t s_defaultIdleReleaseTime = 10000; /// msec
+/// below this rate dithering flickers instead of smoothing, stage is bypassed
+static const int s_minDitherFps = 60;
+
+/// Controller settings and grabs prepared without GL or network resources,
+/// see ofxLedController::ReadConfig and ofxLedLayoutBin
+struct LedControllerConfig {
+    unsigned int id = 0;
+    LedOutputType outputType = LedOutputTypeLedmap;
+    /// controller and output settings without grabs, empty when no config found
+    ofJson settings;
+    ofxLedGrabPool grabPool;
+    ChannelsGrabObjects channelGrabObjects;
+};
 
 /// Class represents connection to one client recieving led data and
 /// control transmition params like fps, pixel color order, LED IC Type
@@ -39,6 +65,7 @@ using ChannelsGrabObjects = vector<vector<unique_ptr<ofxLedGrab>>>;
 class ofxLedController {
 public:
     ofxLedController(int _id, LedOutputType outputType, const string &_path);
+    ofxLedController(LedControllerConfig &&config, const string &_path);
     ofxLedController() = delete;
     ofxLedController(const ofxLedController &) = delete;
     ofxLedController(ofxLedController &&) = delete;
@@ -48,13 +75,67 @@ public:
 
     void save(const string &path);
     void load(const string &path);
-
-    static unique_ptr<ofxLedGrab> GetUniqueTypedGrab(const ofxLedGrab *grab);
-    void addGrab(unique_ptr<ofxLedGrab> &&object);
+    static LedControllerConfig ReadConfig(unsigned int id, LedOutputType outputType,
+                                          const string &path);
+    /// controller and output settings without grabs
+    ofJson getSettingsJson();
+    LedControllerConfig getConfigSnapshot();
+    /// snapshot shared with saver, taken again only when config changed since previous one
+    shared_ptr<const LedControllerConfig> getSharedConfigSnapshot();
+    /// true when settings or grabs changed since load or last save
+    bool isConfigDirty() const;
+    void markConfigSaved();
+    /// hot reload: apply config read from disk, unchanged grabs and output are kept
+    bool applyConfigDiff(LedControllerConfig &&config);
+
+    /// create grab in controllers pool and add to current channel
+    template <typename T, typename... Args>
+    GrabHandle addGrab(Args &&... args)
+    {
+        return addGrab(m_grabPool.create<T>(std::forward<Args>(args)...));
+    }
+    /// add typed copy of grab to current channel
+    GrabHandle addGrab(const ofxLedGrab &grab) { return addGrab(m_grabPool.clone(grab)); }
+    /// Add many grabs as one transaction: whole batch is rejected if any grab has wrong type or
+    /// channel or channel would exceed max pixels, layout is rebuilt once on next update
+    bool addGrabs(const vector<LedGrabDesc> &descs, bool replaceExisting = false);
+    bool addGrabs(vector<LedGrabDesc> &&descs, bool replaceExisting = false);
+    /// add selected copies of grabs to current channel, shifted by offset
+    bool addGrabs(const vector<const ofxLedGrab *> &grabs, const ofVec2f &offset);
+    /// replace layout with pixel map from CSV or binary file, see ofxLedGrabPixelMapLoad.h
+    bool importPixelMap(const string &path);
     void deleteSelectedGrabs();
+    /// revert / repeat last grab edit, only grabs touched by it are recreated
+    bool undo();
+    bool redo();
+    bool canUndo() const { return m_history.canUndo(); }
+    bool canRedo() const { return m_history.canRedo(); }
+    /// oldest undo steps are dropped when history takes more memory
+    void setHistoryMemoryLimit(size_t bytes) { m_history.setMemoryLimit(bytes); }
     void draw();
 
     void send(const ofTexture &texIn);
+    /// CPU path for frames that are already in memory, samples without GL
+    void send(const ofPixels &pixIn);
+    /// several sources merged at LED positions, see LedMergeMode
+    void send(const vector<LedSourceLayer> &layers);
+    /// crossfade of two sources on sampled frames, progress of fade is taken when frame is
+    /// sampled. Empty "from" fades from frame that was sent when fade started
+    void send(const vector<LedSourceLayer> &from, const vector<LedSourceLayer> &to,
+              const LedCueFade &fade);
+    void setMergeMode(LedMergeMode mode)
+    {
+        m_mergeMode = mode;
+        markSettingsChanged();
+    }
+    /// name of source in ofxLedMapper::send(sources), empty is default source
+    void setSource(const string &source)
+    {
+        m_source = source;
+        markSettingsChanged();
+    }
+    const string &getSource() const { return m_source; }
+    LedMergeMode getMergeMode() const { return m_mergeMode.load(); }
 
     /// mouse and keyboard events
     void mousePressed(ofMouseEventArgs &args);
@@ -72,7 +153,8 @@ public:
 #endif
 
     const ChannelsGrabObjects &peekGrabObjects() const { return m_channelGrabObjects; };
-    const vector<unique_ptr<ofxLedGrab>> &peekCurrentGrabs() const { return *m_currentChannel; };
+    const vector<GrabHandle> &peekCurrentGrabs() const { return *m_currentChannel; };
+    const ofxLedGrab *peekGrab(GrabHandle handle) const { return m_grabPool.get(handle); }
 
     bool isSelected() const { return m_bSelected; }
     bool isStatusOk() const { return m_statusOk; }
@@ -80,36 +162,142 @@ public:
 
     // string getIP() const { return m_ledOut.getIP(); }
     unsigned int getId() const { return m_id; }
-    unsigned int getTotalLeds() const { return m_totalLeds; }
-
-    void markDirtyGrabPoints() { m_bDirtyPoints = true; }
+    unsigned int getTotalLeds() const { return peekLayout()->totalLeds; }
+    size_t getMaxPixInChannel() const { return m_maxPixInChannel; }
+
+    void markDirtyGrabPoints()
+    {
+        m_bDirtyPoints = true;
+        ++m_layoutRevision;
+    }
+    /// settings that go to config changed, see isConfigDirty
+    void markSettingsChanged() { ++m_settingsRevision; }
     void setPixInLed(const float pixInled);
+    /// Editor side: compile changed grabs into new layout snapshot and publish it,
+    /// called by draw, ofxLedMapper::update and send from the thread that edits grabs.
+    /// Send from another thread only sees layout published by editor thread
     void updateGrabPoints();
+    /// Output side: latest published layout, safe to read from any thread
+    LedLayoutPtr peekLayout() const { return std::atomic_load(&m_layout); }
     ChannelsToPix updatePixels(const ofTexture &);
+    ChannelsToPix updatePixels(const ofPixels &);
 
     void setFps(float fps);
+    /// resources of controller that doesn't send are freed after msec, 0 keeps them
+    void setIdleReleaseTime(uint64_t msec);
+    uint64_t getIdleReleaseTime() const { return m_idleReleaseTime; }
+    bool isResourcesActive() const { return m_bResourcesActive; }
+    void releaseIfIdle();
     void setSelected(bool state);
     void setGrabsSelected(bool state);
-    void setGrabType(LMGrabType type) { m_currentGrabType = type; }
+    /// changing tool finishes path drawn with mouse
+    void setGrabType(LMGrabType type)
+    {
+        if (type != m_currentGrabType)
+            m_openPath = {};
+        m_currentGrabType = type;
+    }
 
     GRAB_COLOR_TYPE getColorType(int num) const;
     void setColorType(GRAB_COLOR_TYPE);
+    /// gamma, brightness and white balance applied to sampled LEDs before output,
+    /// grabs with own correction keep it
+    void setColorCorrection(const LedColorCorrection &correction);
+    const LedColorCorrection &getColorCorrection() const { return m_colorCorrection; }
+    /// temporal dithering of corrected output, works only with fps >= s_minDitherFps
+    void setDithering(bool state);
+    bool isDithering() const { return m_bDither; }
+    /// with interpolation sent frames are blended and sent from own thread at controller fps,
+    /// independent of how often send is called
+    void setInterpolation(LedInterpolation mode);
+    LedInterpolation getInterpolation() const { return m_interpolation.load(); }
+    /// temporal filter of sampled LEDs, settings can be changed from any thread,
+    /// call markSettingsChanged after to save them
+    ofxLedSmoothing &getSmoothing() { return m_smoothing; }
+    /// per channel and controller current budgets, applied to every sent frame,
+    /// call markSettingsChanged after changing them to save them
+    ofxLedPowerLimiter &getPowerLimiter() { return m_powerLimiter; }
+    LedPowerTelemetryPtr peekPowerTelemetry() const { return m_powerLimiter.peekTelemetry(); }
+    /// append every sent frame to capture file, see LedCaptureFormat
+    bool startRecording(const string &path);
+    void stopRecording();
+    bool isRecording() const { return m_bRecording; }
+    /// send frames of capture file on output thread instead of sampled ones, send calls are
+    /// ignored meanwhile. startTime in usec of ofGetElapsedTimeMicros, 0 starts now
+    bool startPlayback(const string &path, bool loop = true, uint64_t startTime = 0);
+    void stopPlayback();
+    /// time in usec from start of capture
+    void seekPlayback(uint64_t time);
+    bool isPlaying() const { return m_bPlaying; }
+    /// hold while changing output settings outside of controller, e.g. output gui update
+    std::unique_lock<std::recursive_mutex> lockOutput()
+    {
+        return std::unique_lock<std::recursive_mutex>(m_outputMutex);
+    }
 
     const ofRectangle &peekBounds() const { return m_grabBounds; }
 
 private:
     void updateSelectionRect(ofRectangle &rect, const ofMouseEventArgs &args);
+    void applyConfig(LedControllerConfig &&config);
+    void setOutputType(LedOutputType outputType);
+    bool beginFrame();
+    void sendFrame(ChannelsToPix &&grabbedPixs);
+    /// keepFrame stores sampled frame for the next cue fade to start from
+    void sendSampled(const function<ChannelsToPix(const LedLayout &)> &sample,
+                     bool keepFrame = false);
+    void enableCpuGather();
+    ChannelsToPix compositeLayers(const vector<LedSourceLayer> &layers, const LedLayout &layout);
+    ChannelsToPix samplePixels(const ofTexture &texIn, const LedLayout &layout);
+    ChannelsToPix samplePixels(const ofPixels &pixIn, const LedLayout &layout);
+    /// smoothing, color correction and dithering of sampled frame
+    void processPixels(const LedLayout &layout, ChannelsToPix &pixels);
+    /// push sampled frame to interpolator, started output thread sends it
+    void pushFrame(ChannelsToPix &&pixels, LedLayoutPtr layout);
+    void startOutputThread();
+    void updateOutputThread();
+    void stopOutputThread();
+    void outputThreadFunction();
+    /// send capture frame for current playback time, output thread only
+    void playbackFrame();
+    void activateResources();
+    void allocateGrabFbo();
+    void releaseResources();
 
     unsigned int m_id;
     string m_path;
 
-    bool m_bSelected, m_bSend, m_statusOk, m_bDirtyPoints;
+    bool m_bSelected, m_bSend, m_bDirtyPoints;
+    /// thread that created controller edits its grabs, send publishes edits only from it
+    std::thread::id m_editorThread = std::this_thread::get_id();
+    /// set by output thread, status callback is called on main thread in notifyStatusChange
+    std::atomic<bool> m_statusOk, m_bStatusChanged;
+    void notifyStatusChange();
     ofColor m_colorLine, m_colorActive, m_colorInactive;
 
-    unsigned int m_totalLeds;
     vector<char> m_output;
     LedOutput m_ledOut;
-
+    /// guards m_ledOut while output thread sends, gui callbacks lock it again under lockOutput
+    std::recursive_mutex m_outputMutex;
+
+    std::atomic<LedInterpolation> m_interpolation;
+    std::atomic<LedMergeMode> m_mergeMode;
+    string m_source;
+    ofxLedFrameInterpolator m_interpolator;
+    std::thread m_outputThread;
+    std::mutex m_threadMutex;
+    std::condition_variable m_threadCondition;
+    bool m_bThreadExit;
+
+    LedLayoutPtr m_layout;
+    /// layout revision that is in m_vboLeds
+    uint64_t m_uploadedRevision;
+    void uploadLayout(const LedLayout &layout);
+    /// set on first send with ofPixels, layout then compiles matrix grids and sample table
+    std::atomic<bool> m_bCpuGather;
+    /// recompile layout tables without new revision of points
+    std::atomic<bool> m_bDirtyLayout;
+    vector<char> m_gatherLeds;
     ofVboMesh m_vboLeds;
     ofShader m_shaderGrab;
     ofFbo m_fboLeds;
@@ -117,27 +305,79 @@ private:
 
     function<void(void)> m_statusChanged;
 
+    GrabHandle addGrab(GrabHandle handle);
+    bool commitGrabs(const vector<GrabHandle> &grabs, bool replaceExisting, bool select);
+    size_t countChannelLeds(size_t chan) const;
+
+    /// grabs in current channel that mouse can change, compared on release
+    struct EditGesture {
+        bool active = false;
+        size_t channel = 0;
+        size_t channelSize = 0;
+        vector<pair<size_t, LedGrabDesc>> before;
+    };
+    void beginGesture();
+    void endGesture();
+    bool applyEdit(const LedGrabEdit &edit, const vector<LedGrabDesc> &remove,
+                   const vector<LedGrabDesc> &insert);
+    void resetHistory();
+    ofxLedGrabHistory m_history;
+    EditGesture m_gesture;
+
     void setCurrentChannel(int);
+    ofxLedGrabPool m_grabPool;
     ChannelsGrabObjects m_channelGrabObjects;
-    vector<unique_ptr<ofxLedGrab>> *m_currentChannel;
+    vector<GrabHandle> *m_currentChannel;
     size_t m_currentChannelNum;
 
     vector<string> m_channelList;
-    vector<uint16_t> m_channelsTotalLeds;
-    vector<glm::vec3> m_ledPoints;
     size_t m_maxPixInChannel;
 
     LMGrabType m_currentGrabType;
+    /// path that gets point on every click in GRAB_PATH mode
+    GrabHandle m_openPath;
     ofRectangle m_grabBounds;
 
     ofxXmlSettings XML;
     void parseXml(ofxXmlSettings &XML);
 
     GRAB_COLOR_TYPE m_colorType;
+    LedColorCorrection m_colorCorrection;
+    /// rebuilt on correction or color type change, read by output with atomic_load
+    LedColorLutPtr m_colorLut;
+    void updateColorLut();
+    bool m_bDither;
+    ofxLedDither m_dither;
+    ofxLedSmoothing m_smoothing;
+    ofxLedPowerLimiter m_powerLimiter;
+    /// used by output under m_outputMutex
+    unique_ptr<ofxLedCaptureWriter> m_recorder;
+    std::atomic<bool> m_bRecording;
+    /// owned by output thread while playing
+    unique_ptr<ofxLedCaptureReader> m_player;
+    size_t m_playIndex;
+    std::atomic<bool> m_bPlaying, m_bPlayLoop;
+    std::atomic<uint64_t> m_playStart;
+    /// last sampled frame of cue before processing, kept only while cues are played,
+    /// and frame that fade without source starts from, taken at fade with m_fadeFromStart
+    ChannelsToPix m_lastFrame, m_fadeFrom;
+    bool m_bHasFadeFrom;
+    uint64_t m_fadeFromStart;
+    ofxLedDither *getActiveDither();
     float m_pixelsInLed;
     int m_fps;
 
-    uint64_t m_lastFrameTime, m_msecInFrame;
+    /// m_lastFrameTime in msec for idle release, frames are scheduled in usec
+    uint64_t m_lastFrameTime, m_nextFrameTime;
+    std::atomic<uint64_t> m_usecInFrame;
+    uint64_t m_idleReleaseTime;
+    bool m_bResourcesActive;
+
+    uint64_t m_layoutRevision, m_savedLayoutRevision;
+    uint64_t m_settingsRevision, m_savedSettingsRevision;
+    /// last shared snapshot and revisions it was taken at
+    shared_ptr<const LedControllerConfig> m_configSnapshot;
+    uint64_t m_snapshotLayoutRevision, m_snapshotSettingsRevision;
     ofRectangle m_selectionRect;
 };
 
@@ -25,6 +25,7 @@
 #include "Common.h"
 #include "ofMain.h"
 #include "ofxXmlSettings.h"
+#include "process/ofxLedColorCorrection.h"
 
 namespace LedMapper {
 
@@ -32,10 +33,59 @@ class ofxLedGrab;
 class ofxLedGrabLine;
 class ofxLedGrabCircle;
 class ofxLedGrabMatrix;
-
-enum LMGrabType { GRAB_EMPTY, GRAB_LINE, GRAB_CIRCLE, GRAB_MATRIX, GRAB_SELECT };
+class ofxLedGrabPoints;
+class ofxLedGrabPath;
+
+enum LMGrabType {
+    GRAB_EMPTY,
+    GRAB_LINE,
+    GRAB_CIRCLE,
+    GRAB_MATRIX,
+    GRAB_SELECT,
+    GRAB_POINTS,
+    GRAB_PATH
+};
 static const ofColor s_colorGreen = ofColor::fromHex(LM_COLOR_GREEN_LIGHT);
 
+/// Plain description of grab for programmatic layouts, see ofxLedController::addGrabs
+struct LedGrabDesc {
+    LMGrabType type = LMGrabType::GRAB_LINE;
+    int channel = 0;
+    ofVec2f from, to;
+    /// line
+    bool isDouble = false;
+    /// circle
+    float startAngle = -90.f;
+    bool isClockwise = true;
+    /// matrix
+    bool isVertical = true, isZigzag = true;
+    /// GRAB_POINTS coordinates in wiring order or GRAB_PATH control points
+    vector<ofVec2f> points;
+    /// path
+    bool isBezier = false;
+    /// overrides controller color correction when set
+    bool hasColorCorrection = false;
+    LedColorCorrection colorCorrection;
+
+    bool operator==(const LedGrabDesc &rhs) const
+    {
+        return type == rhs.type && channel == rhs.channel && from == rhs.from && to == rhs.to
+               && isDouble == rhs.isDouble && startAngle == rhs.startAngle
+               && isClockwise == rhs.isClockwise && isVertical == rhs.isVertical
+               && isZigzag == rhs.isZigzag && points == rhs.points && isBezier == rhs.isBezier
+               && hasColorCorrection == rhs.hasColorCorrection
+               && colorCorrection == rhs.colorCorrection;
+    }
+    bool operator!=(const LedGrabDesc &rhs) const { return !(*this == rhs); }
+};
+
+/// Axis aligned grid of LEDs: run r is column at x = runX[r], LED i of run is at y = ledY[i],
+/// odd runs are wired in reverse on zigzag. See ofxLedGrabMatrix::getGrid
+struct LedGrid {
+    vector<float> runX, ledY;
+    bool isZigzag = false;
+};
+
 /// based on  glm::closestPointOnLine
 inline float getPointDistanceToLine(const ofVec2f &point, const ofVec2f &lineFrom,
                                     const ofVec2f &lineTo)
@@ -63,9 +113,14 @@ public:
         , m_bSelected(false)
         , m_bSelectedFrom(false)
         , m_bSelectedTo(false)
+        , m_channel(0)
+        , m_pixelsInObject(0)
         , m_pixelsInLed(pixInLed)
+        , m_startAngle(0.f)
+        , m_hasColorCorrection(false)
     {
     }
+    /// copy keeps generated points, so derived copies don't need to call updatePoints
     ofxLedGrab(const ofxLedGrab &line)
         : m_from(line.m_from)
         , m_to(line.m_to)
@@ -74,7 +129,14 @@ public:
         , m_bSelected(false)
         , m_bSelectedFrom(false)
         , m_bSelectedTo(false)
+        , m_channel(line.m_channel)
+        , m_pixelsInObject(line.m_pixelsInObject)
         , m_pixelsInLed(line.m_pixelsInLed)
+        , m_startAngle(line.m_startAngle)
+        , m_hasColorCorrection(line.m_hasColorCorrection)
+        , m_colorCorrection(line.m_colorCorrection)
+        , m_points(line.m_points)
+        , m_bounds(line.m_bounds)
     {
     }
     virtual ~ofxLedGrab(){};
@@ -114,11 +176,14 @@ public:
 
     virtual ofJson toJson() const
     {
-        return ofJson{ { "channel", m_channel },
-                       { "fromX", m_from.x },
-                       { "fromY", m_from.y },
-                       { "toX", m_to.x },
-                       { "toY", m_to.y } };
+        ofJson out{ { "channel", m_channel },
+                    { "fromX", m_from.x },
+                    { "fromY", m_from.y },
+                    { "toX", m_to.x },
+                    { "toY", m_to.y } };
+        if (m_hasColorCorrection)
+            out["colorCorrection"] = m_colorCorrection.toJson();
+        return out;
     }
     virtual void fromJson(const ofJson &j)
     {
@@ -127,6 +192,36 @@ public:
                    j.count("fromY") ? j.at("fromY").get<float>() : 0.f };
         m_to = { j.count("toX") ? j.at("toX").get<float>() : 0.f,
                  j.count("toY") ? j.at("toY").get<float>() : 0.f };
+        m_hasColorCorrection = j.count("colorCorrection") > 0;
+        m_colorCorrection.fromJson(m_hasColorCorrection ? j.at("colorCorrection") : ofJson());
+    }
+
+    /// description to recreate grab, see ofxLedGrabPool::create
+    virtual LedGrabDesc toDesc() const
+    {
+        LedGrabDesc desc;
+        desc.type = static_cast<LMGrabType>(m_type);
+        desc.channel = m_channel;
+        desc.from = m_from;
+        desc.to = m_to;
+        desc.startAngle = m_startAngle;
+        desc.hasColorCorrection = m_hasColorCorrection;
+        desc.colorCorrection = m_colorCorrection;
+        return desc;
+    }
+    /// restore grab from description with already generated points, e.g. from compiled layout
+    virtual void restore(const LedGrabDesc &desc, float pixelsInLed, const ofVec2f *points,
+                         size_t size)
+    {
+        m_channel = desc.channel;
+        m_from = desc.from;
+        m_to = desc.to;
+        m_startAngle = desc.startAngle;
+        m_hasColorCorrection = desc.hasColorCorrection;
+        m_colorCorrection = desc.colorCorrection;
+        m_pixelsInLed = pixelsInLed;
+        m_points.assign(points, points + size);
+        m_pixelsInObject = size;
     }
 
     void set(const ofVec2f &from, const ofVec2f &to)
@@ -160,6 +255,23 @@ public:
     unsigned int getObjectId() const { return m_id; };
     void setChannel(int _channel) { m_channel = _channel; }
     int getChannel() const { return m_channel; }
+
+    /// per grab color correction, replaces controller one for LEDs of this grab
+    void setColorCorrection(const LedColorCorrection &correction)
+    {
+        m_hasColorCorrection = true;
+        m_colorCorrection = correction;
+    }
+    void clearColorCorrection()
+    {
+        m_hasColorCorrection = false;
+        m_colorCorrection = LedColorCorrection();
+    }
+    /// nullptr when grab uses controller color correction
+    const LedColorCorrection *getColorCorrection() const
+    {
+        return m_hasColorCorrection ? &m_colorCorrection : nullptr;
+    }
     void setActive(bool active) { m_bActive = active; }
     bool isActive() const { return m_bActive; }
     void setSelected(bool selected) { m_bSelected = selected; }
@@ -187,6 +299,8 @@ public:
     int m_channel, m_pixelsInObject;
     float m_pixelsInLed, m_startAngle;
     ofVec2f m_from, m_to, m_clickedPos;
+    bool m_hasColorCorrection;
+    LedColorCorrection m_colorCorrection;
 
     vector<ofVec2f> m_points;
     ofRectangle m_bounds;
@@ -248,7 +362,6 @@ public:
         : ofxLedGrab(line)
         , m_isDoubleLine(line.m_isDoubleLine)
     {
-        updatePoints();
     }
 
     ~ofxLedGrabLine(){};
@@ -352,6 +465,22 @@ public:
         m_bounds.set(min - ofVec2f(POINT_RAD), max + ofVec2f(POINT_RAD));
     }
 
+    bool isDoubleLine() const { return m_isDoubleLine; }
+
+    LedGrabDesc toDesc() const override
+    {
+        auto desc = ofxLedGrab::toDesc();
+        desc.isDouble = m_isDoubleLine;
+        return desc;
+    }
+    void restore(const LedGrabDesc &desc, float pixelsInLed, const ofVec2f *points,
+                 size_t size) override
+    {
+        m_isDoubleLine = desc.isDouble;
+        ofxLedGrab::restore(desc, pixelsInLed, points, size);
+        updateBounds();
+    }
+
     void save(ofxXmlSettings &xml, const int tagNum) override
     {
         ofxLedGrab::save(xml, tagNum);
@@ -381,12 +510,51 @@ public:
 class ofxLedGrabCircle : public ofxLedGrab {
     float m_radius;
     bool m_isClockwise;
+    /// LEDs left of or above frame origin, moved to frame edge
+    size_t m_numClamped;
+
+    /// LEDs along circle of current radius, appended to points when given,
+    /// returns number of LEDs clamped to frame edge
+    size_t generatePoints(vector<ofVec2f> *points) const
+    {
+        float dist = m_radius * TWO_PI;
+        int pixelsInLine = static_cast<int>(dist / m_pixelsInLed);
+        if (pixelsInLine <= 0)
+            return 0;
+        if (points != nullptr)
+            points->reserve(pixelsInLine);
+
+        /// rotate unit vector by fixed step instead of cos / sin for every LED,
+        /// in double drift stays far below LED size for any count
+        double step = (m_isClockwise ? -TWO_PI : TWO_PI) / pixelsInLine;
+        double stepCos = cos(step), stepSin = sin(step);
+        double x = cos(m_startAngle * PI / 180), y = sin(m_startAngle * PI / 180);
+        size_t numClamped = 0;
+        for (int i = 0; i < pixelsInLine; i++) {
+            ofVec2f tmp(m_from.x + x * m_radius, m_from.y + y * m_radius);
+            /// LED off the screen keeps its slot and reads frame edge, so count doesn't change
+            /// while circle is dragged over the edge
+            if (tmp.x < 0 || tmp.y < 0) {
+                tmp.x = std::max(tmp.x, 0.f);
+                tmp.y = std::max(tmp.y, 0.f);
+                ++numClamped;
+            }
+            if (points != nullptr)
+                points->push_back(tmp);
+
+            double rotatedX = x * stepCos - y * stepSin;
+            y = x * stepSin + y * stepCos;
+            x = rotatedX;
+        }
+        return numClamped;
+    }
 
 public:
     ofxLedGrabCircle(const ofVec2f &from = ofVec2f(0), const ofVec2f &to = ofVec2f(0),
                      float pixInLed = 2.f)
         : ofxLedGrab(from, to, pixInLed)
         , m_isClockwise(true)
+        , m_numClamped(0)
     {
         ofxLedGrab::m_type = LMGrabType::GRAB_CIRCLE;
         ofxLedGrab::m_startAngle = -90.f;
@@ -395,10 +563,10 @@ public:
 
     ofxLedGrabCircle(const ofxLedGrabCircle &circle)
         : ofxLedGrab(circle)
+        , m_radius(circle.m_radius)
         , m_isClockwise(circle.m_isClockwise)
+        , m_numClamped(circle.m_numClamped)
     {
-        ofxLedGrab::m_startAngle = circle.m_startAngle;
-        updatePoints();
     }
 
     ~ofxLedGrabCircle(){};
@@ -458,38 +626,50 @@ public:
         if (isActive()) {
             ofFill();
             ofSetColor(150, 150, 150, 150); /// color for first point
-            ofDrawCircle((*m_points.begin()), m_pixelsInLed / 1.5);
+            if (!m_points.empty())
+                ofDrawCircle((*m_points.begin()), m_pixelsInLed / 1.5);
             ofSetColor(s_colorGreen);
             ofDrawBitmapString("id" + ofToString(m_id), m_from);
             if (!m_bSelected)
                 return;
-            ofDrawBitmapString(ofToString(static_cast<int>(m_points.size())),
-                               m_from.getInterpolated(m_to, .5));
+            string count = ofToString(static_cast<int>(m_points.size()));
+            if (m_numClamped > 0)
+                count += " (" + ofToString(m_numClamped) + " clamped)";
+            ofDrawBitmapString(count, m_from.getInterpolated(m_to, .5));
         }
     }
 
     void drawGui() override { ; }
 
     void setClockwise(bool bClock) { m_isClockwise = bClock; }
+    bool isClockwise() const { return m_isClockwise; }
+    size_t getNumClamped() const { return m_numClamped; }
+
+    LedGrabDesc toDesc() const override
+    {
+        auto desc = ofxLedGrab::toDesc();
+        desc.isClockwise = m_isClockwise;
+        return desc;
+    }
+    void restore(const LedGrabDesc &desc, float pixelsInLed, const ofVec2f *points,
+                 size_t size) override
+    {
+        m_isClockwise = desc.isClockwise;
+        ofxLedGrab::restore(desc, pixelsInLed, points, size);
+        m_radius = m_from.distance(m_to);
+        /// stored LEDs are already clamped, count is recomputed from geometry
+        /// only when circle crosses frame edge
+        bool crossesEdge = m_from.x < m_radius || m_from.y < m_radius;
+        m_numClamped = crossesEdge ? generatePoints(nullptr) : 0;
+        updateBounds();
+    }
 
     void updatePoints() override
     {
         updateBounds();
         m_radius = m_from.distance(m_to);
-        float dist = m_radius * TWO_PI;
-        int pixelsInLine = static_cast<int>(dist / m_pixelsInLed);
-        float degreeStep = 360.f / static_cast<float>(pixelsInLine);
-        float currStep = m_startAngle;
         m_points.clear();
-        m_points.reserve(pixelsInLine);
-        for (int i = 0; i < pixelsInLine; i++) {
-            ofVec2f tmp = ofVec2f(cos(currStep * PI / 180), sin(currStep * PI / 180)) * m_radius;
-            tmp += m_from;
-            // check if point is on the screen
-            if (tmp.x >= 0 && tmp.y >= 0)
-                m_points.push_back(tmp);
-            m_isClockwise ? currStep -= degreeStep : currStep += degreeStep;
-        }
+        m_numClamped = generatePoints(&m_points);
     }
     void updateBounds() override
     {
@@ -544,10 +724,11 @@ public:
 
     ofxLedGrabMatrix(const ofxLedGrabMatrix &grab)
         : ofxLedGrab(grab)
+        , m_columns(grab.m_columns)
+        , m_rows(grab.m_rows)
         , m_isVertical(grab.m_isVertical)
         , m_isZigzag(grab.m_isZigzag)
     {
-        updatePoints();
     }
 
     ~ofxLedGrabMatrix() {}
@@ -636,14 +817,70 @@ public:
 
     void setNumRows(int rows) { m_rows = rows; }
     void setNumColumns(int columns) { m_columns = columns; }
+    bool isVertical() const { return m_isVertical; }
+    bool isZigzag() const { return m_isZigzag; }
+
+    /// columns of LEDs are runs, x of column and y of LED in it are computed separately,
+    /// so all LEDs of column share exactly the same x
+    int getNumRuns() const { return m_isVertical ? m_rows : m_columns; }
+    int getRunLength() const { return m_isVertical ? m_columns : m_rows; }
+    float getRunX(int run) const
+    {
+        return m_isVertical ? ofLerp(m_from.x, m_to.x, (run + .5f) / m_rows)
+                            : m_from.x + run * m_pixelsInLed;
+    }
+    float getLedY(int led) const
+    {
+        return m_isVertical ? ofLerp(m_from.y, m_to.y, (led + .5f) / m_columns)
+                            : m_from.y + led * m_pixelsInLed;
+    }
 
-    void updatePoints() override
+    /// same positions as updatePoints, false when some LEDs were cut off by frame origin
+    bool getGrid(LedGrid &grid) const
+    {
+        int runs = getNumRuns(), runLength = getRunLength();
+        if (runs <= 0 || runLength <= 0 || m_points.size() != static_cast<size_t>(runs) * runLength)
+            return false;
+
+        grid.runX.resize(runs);
+        for (int run = 0; run < runs; ++run)
+            grid.runX[run] = getRunX(run);
+        grid.ledY.resize(runLength);
+        for (int led = 0; led < runLength; ++led)
+            grid.ledY[led] = getLedY(led);
+        grid.isZigzag = m_isVertical && m_isZigzag;
+        return true;
+    }
+
+    LedGrabDesc toDesc() const override
+    {
+        auto desc = ofxLedGrab::toDesc();
+        desc.isVertical = m_isVertical;
+        desc.isZigzag = m_isZigzag;
+        return desc;
+    }
+    void restore(const LedGrabDesc &desc, float pixelsInLed, const ofVec2f *points,
+                 size_t size) override
     {
+        m_isVertical = desc.isVertical;
+        m_isZigzag = desc.isZigzag;
+        ofxLedGrab::restore(desc, pixelsInLed, points, size);
+        updateGridSize();
         updateBounds();
+    }
+
+    void updateGridSize()
+    {
         m_columns = static_cast<int>(m_isVertical ? abs(m_from.y - m_to.y) / m_pixelsInLed
                                                   : abs(m_from.x - m_to.x) / m_pixelsInLed);
         m_rows = static_cast<int>(m_isVertical ? abs(m_from.x - m_to.x) / m_pixelsInLed
                                                : abs(m_from.y - m_to.y) / m_pixelsInLed);
+    }
+
+    void updatePoints() override
+    {
+        updateBounds();
+        updateGridSize();
 
         m_pixelsInObject = m_columns * m_rows;
 
@@ -652,10 +889,7 @@ public:
 
         if (m_isVertical) {
             for (int row = 0; row < m_rows; ++row) {
-                ofVec2f rowPos = m_from.getInterpolated(ofVec2f(m_to.x, m_from.y),
-                                                        (static_cast<float>(row) + .5f) / m_rows);
-                // ofLogVerbose("row/m_rows =" + ofToString(static_cast<float>(row + 1)/m_rows ) + "
-                // -> " + ofToString(rowPos));
+                float rowX = getRunX(row);
                 int cntr, maxCntr, increment;
                 // on zigzag start not %2 from opposite side
                 if (m_isZigzag && row % 2 == 1) {
@@ -670,8 +904,7 @@ public:
                 }
 
                 while (cntr != maxCntr) {
-                    ofVec2f tmp = rowPos.getInterpolated(
-                        ofVec2f(rowPos.x, m_to.y), (static_cast<float>(cntr) + .5f) / m_columns);
+                    ofVec2f tmp(rowX, getLedY(cntr));
                     if (tmp.x >= 0 && tmp.y >= 0)
                         m_points.emplace_back(std::move(tmp));
                     cntr += increment;
@@ -681,8 +914,7 @@ public:
         else {
             for (int col = 0; col < m_columns; ++col) {
                 for (int row = 0; row < m_rows; ++row) {
-                    ofVec2f tmp = ofVec2f(col * m_pixelsInLed, row * m_pixelsInLed);
-                    tmp += m_from;
+                    ofVec2f tmp(getRunX(col), getLedY(row));
                     if (tmp.x >= 0 && tmp.y >= 0)
                         m_points.emplace_back(std::move(tmp));
                 }
@@ -729,6 +961,506 @@ public:
         m_isZigzag = j.count("isZigzag") ? j.at("isZigzag").get<bool>() : true;
     }
 };
+
+/// Arbitrary ordered LED coordinates, e.g. imported pixel maps.
+/// Points are not generated from from/to, so moving grab translates them and pixel step is ignored
+class ofxLedGrabPoints : public ofxLedGrab {
+    ofVec2f m_origin;
+
+public:
+    ofxLedGrabPoints(vector<ofVec2f> points = {})
+        : ofxLedGrab()
+    {
+        ofxLedGrab::m_type = LMGrabType::GRAB_POINTS;
+        setPoints(move(points));
+    }
+
+    ofxLedGrabPoints(const ofxLedGrabPoints &grab)
+        : ofxLedGrab(grab)
+        , m_origin(grab.m_origin)
+    {
+    }
+
+    ~ofxLedGrabPoints() {}
+
+    void setPoints(vector<ofVec2f> points)
+    {
+        m_points = move(points);
+        resetOrigin();
+    }
+
+    void addPoints(const ofVec2f *points, size_t size)
+    {
+        m_points.insert(m_points.end(), points, points + size);
+        resetOrigin();
+    }
+
+    /// points moved by drag since last update are translated here,
+    /// so description matches grab before updatePoints
+    LedGrabDesc toDesc() const override
+    {
+        auto desc = ofxLedGrab::toDesc();
+        desc.points = m_points;
+        auto offset = m_from - m_origin;
+        if (offset != ofVec2f(0)) {
+            for (auto &point : desc.points)
+                point += offset;
+        }
+        return desc;
+    }
+
+    /// leds are the points, restored from compiled layout without description points
+    void restore(const LedGrabDesc &desc, float pixelsInLed, const ofVec2f *points,
+                 size_t size) override
+    {
+        ofxLedGrab::restore(desc, pixelsInLed, points, size);
+        resetOrigin();
+    }
+
+    bool mousePressed(ofMouseEventArgs &args) override
+    {
+        ofxLedGrab::setClickedPos(args);
+
+        if (m_bounds.inside(args)) {
+            ofxLedGrab::setSelected(true);
+            return true;
+        }
+        if (!args.hasModifier(OF_KEY_SHIFT))
+            ofxLedGrab::setSelected(false);
+        return false;
+    }
+
+    bool mouseDragged(const ofMouseEventArgs &args) override
+    {
+        if (!m_bSelected)
+            return false;
+
+        ofVec2f dist(args - ofxLedGrab::getClickedPos());
+        ofxLedGrab::setClickedPos(args);
+        ofxLedGrab::set(m_from + dist, m_to + dist);
+        return true;
+    }
+
+    bool mouseReleased(const ofMouseEventArgs &args) override { return true; }
+
+    void draw(const ofColor &color = ofColor(100, 100, 100, 150)) override
+    {
+        ofSetColor(color);
+        ofNoFill();
+        ofDrawRectangle(m_bounds);
+
+        if (isActive()) {
+            ofSetColor(s_colorGreen);
+            ofDrawBitmapString("id" + ofToString(m_id), m_from);
+            if (!m_bSelected)
+                return;
+            ofDrawBitmapString(ofToString(static_cast<int>(m_points.size())),
+                               m_from.getInterpolated(m_to, .5));
+        }
+    }
+
+    void drawGui() override { ; }
+
+    /// translate points by offset of from since last update, to follows bounds
+    void updatePoints() override
+    {
+        auto offset = m_from - m_origin;
+        if (offset != ofVec2f(0)) {
+            for (auto &point : m_points)
+                point += offset;
+        }
+        resetOrigin();
+    }
+
+    void updateBounds() override
+    {
+        if (m_points.empty()) {
+            m_bounds.set(m_from, 0, 0);
+            return;
+        }
+        ofVec2f min(m_points.front()), max(m_points.front());
+        for (const auto &point : m_points) {
+            min.x = MIN(min.x, point.x);
+            min.y = MIN(min.y, point.y);
+            max.x = MAX(max.x, point.x);
+            max.y = MAX(max.y, point.y);
+        }
+        m_bounds.set(min, max);
+    }
+
+    void save(ofxXmlSettings &xml, const int tagNum) override
+    {
+        ofxLedGrab::save(xml, tagNum);
+        xml.setValue("LN:TYPE", this->m_type, tagNum);
+    }
+
+    void load(ofxXmlSettings &xml, int tagNum) override { ; }
+
+    ofJson toJson() const override
+    {
+        ofJson out = ofxLedGrab::toJson();
+        out["type"] = m_type;
+        /// flat x,y pairs to keep big pixel maps compact
+        ofJson points = ofJson::array();
+        for (const auto &point : m_points) {
+            points.push_back(point.x);
+            points.push_back(point.y);
+        }
+        out["points"] = move(points);
+        return out;
+    }
+    void fromJson(const ofJson &j) override
+    {
+        ofxLedGrab::fromJson(j);
+        m_points.clear();
+        if (j.count("points") && j.at("points").is_array()) {
+            const auto &points = j.at("points");
+            m_points.reserve(points.size() / 2);
+            for (size_t i = 0; i + 1 < points.size(); i += 2)
+                m_points.emplace_back(points[i].get<float>(), points[i + 1].get<float>());
+        }
+        resetOrigin();
+    }
+
+private:
+    void resetOrigin()
+    {
+        m_pixelsInObject = m_points.size();
+        updateBounds();
+        m_from = m_origin = ofVec2f(m_bounds.x, m_bounds.y);
+        m_to = m_from + ofVec2f(m_bounds.width, m_bounds.height);
+    }
+};
+
+/// Curved LED run: polyline or chain of cubic Bezier segments (P0 C0 C1 P1 C2 C3 P2 ...).
+/// LEDs are placed with equal arc-length spacing, arc-length table is cached relative to
+/// the first control point and rebuilt only when control points change shape
+class ofxLedGrabPath : public ofxLedGrab {
+    vector<ofVec2f> m_controlPoints;
+    bool m_isBezier;
+    int m_selectedControl;
+
+    /// arc-length table: curve samples relative to first control point and length at sample
+    vector<ofVec2f> m_lutPoints;
+    vector<float> m_lutLengths;
+    bool m_bDirtyLut;
+
+    static constexpr int s_bezierSegmentSamples = 32;
+
+public:
+    ofxLedGrabPath(vector<ofVec2f> controlPoints = {}, float pixInLed = 2.f, bool isBezier = false)
+        : ofxLedGrab(ofVec2f(0), ofVec2f(0), pixInLed)
+        , m_isBezier(isBezier)
+        , m_selectedControl(-1)
+        , m_bDirtyLut(true)
+    {
+        ofxLedGrab::m_type = LMGrabType::GRAB_PATH;
+        setControlPoints(move(controlPoints));
+    }
+
+    ofxLedGrabPath(const ofxLedGrabPath &grab)
+        : ofxLedGrab(grab)
+        , m_controlPoints(grab.m_controlPoints)
+        , m_isBezier(grab.m_isBezier)
+        , m_selectedControl(-1)
+        , m_lutPoints(grab.m_lutPoints)
+        , m_lutLengths(grab.m_lutLengths)
+        , m_bDirtyLut(grab.m_bDirtyLut)
+    {
+    }
+
+    ~ofxLedGrabPath() {}
+
+    void setControlPoints(vector<ofVec2f> controlPoints)
+    {
+        m_controlPoints = move(controlPoints);
+        m_bDirtyLut = true;
+        syncFromTo();
+        updatePoints();
+    }
+
+    void setControlPoint(size_t index, const ofVec2f &pos)
+    {
+        if (index >= m_controlPoints.size() || pos.x < 0 || pos.y < 0)
+            return;
+        m_controlPoints[index] = pos;
+        m_bDirtyLut = true;
+        syncFromTo();
+        updatePoints();
+    }
+
+    const vector<ofVec2f> &getControlPoints() const { return m_controlPoints; }
+
+    /// append point and drag it until mouse release, used to draw polyline with mouse
+    void addControlPoint(const ofVec2f &pos)
+    {
+        m_controlPoints.push_back(pos);
+        m_selectedControl = static_cast<int>(m_controlPoints.size()) - 1;
+        m_bDirtyLut = true;
+        syncFromTo();
+        updatePoints();
+    }
+
+    void setBezier(bool isBezier)
+    {
+        m_isBezier = isBezier;
+        m_bDirtyLut = true;
+        updatePoints();
+    }
+    bool isBezier() const { return m_isBezier; }
+
+    float getLength() const { return m_lutLengths.empty() ? 0.f : m_lutLengths.back(); }
+
+    LedGrabDesc toDesc() const override
+    {
+        auto desc = ofxLedGrab::toDesc();
+        desc.points = m_controlPoints;
+        desc.isBezier = m_isBezier;
+        return desc;
+    }
+    void restore(const LedGrabDesc &desc, float pixelsInLed, const ofVec2f *points,
+                 size_t size) override
+    {
+        m_controlPoints = desc.points;
+        m_isBezier = desc.isBezier;
+        ofxLedGrab::restore(desc, pixelsInLed, points, size);
+        syncFromTo();
+        updateLut();
+        updateBounds();
+    }
+
+    bool mousePressed(ofMouseEventArgs &args) override
+    {
+        ofxLedGrab::setClickedPos(args);
+        m_selectedControl = -1;
+
+        for (size_t i = 0; i < m_controlPoints.size(); ++i) {
+            if (m_controlPoints[i].distance(args) <= POINT_RAD) {
+                m_selectedControl = i;
+                ofxLedGrab::setSelected(true);
+                return true;
+            }
+        }
+
+        if (m_controlPoints.size() > 1) {
+            const auto &origin = m_controlPoints.front();
+            for (size_t i = 1; i < m_lutPoints.size(); ++i) {
+                if (getPointDistanceToLine(args, origin + m_lutPoints[i - 1],
+                                           origin + m_lutPoints[i])
+                    < POINT_RAD * 2) {
+                    ofxLedGrab::setSelected(true);
+                    return true;
+                }
+            }
+        }
+
+        if (!args.hasModifier(OF_KEY_SHIFT))
+            ofxLedGrab::setSelected(false);
+        return false;
+    }
+
+    bool mouseDragged(const ofMouseEventArgs &args) override
+    {
+        if (m_selectedControl >= 0) {
+            setControlPoint(m_selectedControl, args);
+            return true;
+        }
+        else if (m_bSelected) {
+            ofVec2f dist(args - ofxLedGrab::getClickedPos());
+            ofxLedGrab::setClickedPos(args);
+            ofxLedGrab::set(m_from + dist, m_to + dist);
+            return true;
+        }
+        return false;
+    }
+
+    bool mouseReleased(const ofMouseEventArgs &args) override
+    {
+        m_selectedControl = -1;
+        return true;
+    }
+
+    void draw(const ofColor &color = ofColor(200, 200, 200, 150)) override
+    {
+        if (m_controlPoints.empty())
+            return;
+
+        ofSetColor(color);
+        const auto &origin = m_controlPoints.front();
+        for (size_t i = 1; i < m_lutPoints.size(); ++i)
+            ofDrawLine(origin + m_lutPoints[i - 1], origin + m_lutPoints[i]);
+
+        if (isActive()) {
+            ofFill();
+            for (const auto &point : m_controlPoints)
+                ofDrawCircle(point, 3);
+            if (m_isBezier) {
+                ofSetColor(150, 150, 150, 150); /// handles
+                for (size_t i = 0; i + 3 < m_controlPoints.size(); i += 3) {
+                    ofDrawLine(m_controlPoints[i], m_controlPoints[i + 1]);
+                    ofDrawLine(m_controlPoints[i + 2], m_controlPoints[i + 3]);
+                }
+            }
+            ofSetColor(s_colorGreen);
+            ofDrawBitmapString("id" + ofToString(m_id), m_from + ofVec2f(0, 2));
+            if (!m_bSelected)
+                return;
+            ofDrawBitmapString(ofToString(m_points.size()), m_bounds.x + m_bounds.width * .5f,
+                               m_bounds.y + m_bounds.height * .5f);
+        }
+    }
+
+    void drawGui() override { ; }
+
+    void updatePoints() override
+    {
+        if (m_controlPoints.empty()) {
+            m_points.clear();
+            m_pixelsInObject = 0;
+            return;
+        }
+
+        applyFromTo();
+        if (m_bDirtyLut)
+            updateLut();
+        updateBounds();
+
+        float length = getLength();
+        m_pixelsInObject = static_cast<int>(length / m_pixelsInLed);
+        m_points.clear();
+        m_points.reserve(m_pixelsInObject);
+
+        /// walk table once, LEDs are centered in equal arc-length cells like in ofxLedGrabLine
+        const auto &origin = m_controlPoints.front();
+        size_t sample = 1;
+        for (int pix_num = 0; pix_num < m_pixelsInObject; ++pix_num) {
+            float dist = (static_cast<float>(pix_num) + .5f) * length / m_pixelsInObject;
+            while (sample + 1 < m_lutLengths.size() && m_lutLengths[sample] < dist)
+                ++sample;
+            float segment = m_lutLengths[sample] - m_lutLengths[sample - 1];
+            float step = segment > 0.f ? (dist - m_lutLengths[sample - 1]) / segment : 0.f;
+            const auto &prev = m_lutPoints[sample - 1];
+            m_points.push_back(origin + prev.getInterpolated(m_lutPoints[sample], step));
+        }
+    }
+
+    void updateBounds() override
+    {
+        if (m_controlPoints.empty())
+            return;
+        const auto &origin = m_controlPoints.front();
+        ofVec2f min(origin), max(origin);
+        for (const auto &lutPoint : m_lutPoints) {
+            auto point = origin + lutPoint;
+            min.x = MIN(min.x, point.x);
+            min.y = MIN(min.y, point.y);
+            max.x = MAX(max.x, point.x);
+            max.y = MAX(max.y, point.y);
+        }
+        m_bounds.set(min - ofVec2f(POINT_RAD), max + ofVec2f(POINT_RAD));
+    }
+
+    void save(ofxXmlSettings &xml, const int tagNum) override
+    {
+        ofxLedGrab::save(xml, tagNum);
+        xml.setValue("LN:TYPE", this->m_type, tagNum);
+    }
+
+    void load(ofxXmlSettings &xml, int tagNum) override { ; }
+
+    ofJson toJson() const override
+    {
+        ofJson out = ofxLedGrab::toJson();
+        out["type"] = m_type;
+        out["isBezier"] = m_isBezier;
+        ofJson controlPoints = ofJson::array();
+        for (const auto &point : m_controlPoints) {
+            controlPoints.push_back(point.x);
+            controlPoints.push_back(point.y);
+        }
+        out["controlPoints"] = move(controlPoints);
+        return out;
+    }
+    void fromJson(const ofJson &j) override
+    {
+        ofxLedGrab::fromJson(j);
+        m_isBezier = j.count("isBezier") ? j.at("isBezier").get<bool>() : false;
+        vector<ofVec2f> controlPoints;
+        if (j.count("controlPoints") && j.at("controlPoints").is_array()) {
+            const auto &points = j.at("controlPoints");
+            controlPoints.reserve(points.size() / 2);
+            for (size_t i = 0; i + 1 < points.size(); i += 2)
+                controlPoints.emplace_back(points[i].get<float>(), points[i + 1].get<float>());
+        }
+        setControlPoints(move(controlPoints));
+    }
+
+private:
+    void syncFromTo()
+    {
+        if (m_controlPoints.empty())
+            return;
+        m_from = m_controlPoints.front();
+        m_to = m_controlPoints.back();
+    }
+
+    /// from / to changed by ofxLedGrab::set: same offset on both ends translates whole path
+    /// and keeps table, otherwise only moved end point changes
+    void applyFromTo()
+    {
+        auto offsetFrom = m_from - m_controlPoints.front();
+        auto offsetTo = m_to - m_controlPoints.back();
+        if (offsetFrom == ofVec2f(0) && offsetTo == ofVec2f(0))
+            return;
+
+        if (offsetFrom == offsetTo) {
+            for (auto &point : m_controlPoints)
+                point += offsetFrom;
+            return;
+        }
+        m_controlPoints.front() = m_from;
+        m_controlPoints.back() = m_to;
+        m_bDirtyLut = true;
+    }
+
+    void addLutSample(const ofVec2f &point)
+    {
+        auto relative = point - m_controlPoints.front();
+        m_lutLengths.push_back(m_lutPoints.empty()
+                                   ? 0.f
+                                   : m_lutLengths.back() + m_lutPoints.back().distance(relative));
+        m_lutPoints.push_back(relative);
+    }
+
+    void updateLut()
+    {
+        m_bDirtyLut = false;
+        m_lutPoints.clear();
+        m_lutLengths.clear();
+
+        size_t segmentStart = 0;
+        addLutSample(m_controlPoints.front());
+        if (m_isBezier) {
+            m_lutPoints.reserve(m_controlPoints.size() / 3 * s_bezierSegmentSamples + 1);
+            m_lutLengths.reserve(m_lutPoints.capacity());
+            for (; segmentStart + 3 < m_controlPoints.size(); segmentStart += 3) {
+                const auto &p0 = m_controlPoints[segmentStart];
+                const auto &c0 = m_controlPoints[segmentStart + 1];
+                const auto &c1 = m_controlPoints[segmentStart + 2];
+                const auto &p1 = m_controlPoints[segmentStart + 3];
+                for (int i = 1; i <= s_bezierSegmentSamples; ++i) {
+                    float t = static_cast<float>(i) / s_bezierSegmentSamples;
+                    float u = 1.f - t;
+                    addLutSample(p0 * (u * u * u) + c0 * (3.f * u * u * t) + c1 * (3.f * u * t * t)
+                                 + p1 * (t * t * t));
+                }
+            }
+        }
+        /// polyline or tail points not forming full Bezier segment
+        for (size_t i = segmentStart + 1; i < m_controlPoints.size(); ++i)
+            addLutSample(m_controlPoints[i]);
+    }
+};
 } // namespace LedMapper
 
 namespace nlohmann {
@@ -759,6 +1491,10 @@ template <> struct adl_serializer<std::unique_ptr<LedMapper::ofxLedGrab>> {
                 grab = make_unique<LedMapper::ofxLedGrabMatrix>();
             else if (type == LedMapper::LMGrabType::GRAB_CIRCLE)
                 grab = make_unique<LedMapper::ofxLedGrabCircle>();
+            else if (type == LedMapper::LMGrabType::GRAB_POINTS)
+                grab = make_unique<LedMapper::ofxLedGrabPoints>();
+            else if (type == LedMapper::LMGrabType::GRAB_PATH)
+                grab = make_unique<LedMapper::ofxLedGrabPath>();
 
             try {
                 grab->fromJson(j);
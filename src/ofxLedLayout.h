@@ -0,0 +1,271 @@
+/*
+ Copyright (C) 2017 Timofey Tavlintsev [http://tvl.io]
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+
+#pragma once
+
+#include "Common.h"
+#include "ofMain.h"
+#include "ofxLedGrabObject.h"
+#include "process/ofxLedColorCorrection.h"
+#include "process/ofxLedDither.h"
+
+namespace LedMapper {
+
+/// LED position in source frame and its index in wiring order
+struct LedSample {
+    int32_t x, y;
+    uint32_t led;
+};
+
+/// Matrix grab kept as grid of pixel coordinates,
+/// its LEDs are [firstLed, firstLed + runX.size() * ledY.size())
+struct LedLayoutGrid {
+    uint32_t firstLed = 0;
+    vector<int32_t> runX, ledY;
+    bool isZigzag = false;
+
+    size_t size() const { return runX.size() * ledY.size(); }
+};
+
+/// LEDs [firstLed, firstLed + numLeds) corrected with own LUT
+struct LedLayoutCorrection {
+    uint32_t firstLed = 0, numLeds = 0;
+    LedColorLutPtr lut;
+};
+
+/// Immutable compiled layout of controller: LED positions in wiring order and count of LEDs
+/// per channel. Editor compiles new snapshot after grabs change and swaps it in atomically,
+/// output holds shared_ptr to the snapshot it started frame with, so it never sees half edit
+struct LedLayout {
+    /// matches controller layout revision it was compiled from
+    uint64_t revision = 0;
+    vector<glm::vec3> points;
+    vector<uint16_t> channelsTotalLeds;
+    unsigned int totalLeds = 0;
+    /// CPU gather tables, compiled after controller is sent with ofPixels,
+    /// until then gather goes over points in wiring order
+    bool isGatherCompiled = false;
+    /// matrix grabs, sampled run by run with computed positions
+    vector<LedLayoutGrid> grids;
+    /// rest of points sorted along Morton curve so neighbouring samples read
+    /// neighbouring source rows, led index scatters result back to wiring order
+    vector<LedSample> samples;
+    /// LEDs of grabs that override controller color correction, in wiring order
+    vector<LedLayoutCorrection> corrections;
+};
+
+using LedLayoutPtr = shared_ptr<const LedLayout>;
+
+/// Run controller LUT over sampled channels, LEDs of grabs with own color correction
+/// go through their LUT instead. Channels may be shorter than layout when readback is cut.
+/// With dither LUTs are read at 8.8 precision and dropped fraction is carried to next frame
+static void ApplyColorCorrection(const LedLayout &layout, const ofxLedColorLut &lut,
+                                 ChannelsToPix &pixels, ofxLedDither *dither = nullptr)
+{
+    if (lut.isIdentity() && layout.corrections.empty())
+        return;
+    if (dither != nullptr)
+        dither->resize(layout.totalLeds);
+
+    auto correction = layout.corrections.cbegin();
+    const auto correctionsEnd = layout.corrections.cend();
+    size_t chanBegin = 0;
+    for (size_t chan = 0; chan < pixels.size() && chan < layout.channelsTotalLeds.size();
+         ++chan) {
+        auto &data = pixels[chan];
+        const size_t chanEnd
+            = chanBegin + std::min<size_t>(data.size() / 3, layout.channelsTotalLeds[chan]);
+        size_t led = chanBegin;
+        while (led < chanEnd) {
+            while (correction != correctionsEnd
+                   && correction->firstLed + correction->numLeds <= led)
+                ++correction;
+
+            const ofxLedColorLut *segmentLut = &lut;
+            size_t segmentEnd = chanEnd;
+            if (correction != correctionsEnd && correction->firstLed <= led) {
+                segmentLut = correction->lut.get();
+                segmentEnd = std::min<size_t>(chanEnd, correction->firstLed + correction->numLeds);
+            }
+            else if (correction != correctionsEnd)
+                segmentEnd = std::min<size_t>(chanEnd, correction->firstLed);
+
+            auto *segment = data.data() + (led - chanBegin) * 3;
+            if (dither != nullptr)
+                segmentLut->apply(segment, segmentEnd - led, dither->getErrors(led));
+            else
+                segmentLut->apply(segment, segmentEnd - led);
+            led = segmentEnd;
+        }
+        chanBegin += layout.channelsTotalLeds[chan];
+    }
+}
+
+/// spread lower 16 bits of value to even bits
+static uint32_t MortonSpread(uint32_t value)
+{
+    value &= 0x0000FFFF;
+    value = (value | (value << 8)) & 0x00FF00FF;
+    value = (value | (value << 4)) & 0x0F0F0F0F;
+    value = (value | (value << 2)) & 0x33333333;
+    value = (value | (value << 1)) & 0x55555555;
+    return value;
+}
+
+static uint32_t MortonCode(int32_t x, int32_t y)
+{
+    /// off-frame points are clamped at gather, sort them by the edge they read
+    return MortonSpread(std::max(x, 0)) | (MortonSpread(std::max(y, 0)) << 1);
+}
+
+static LedLayoutGrid CompileLayoutGrid(const LedGrid &grid, uint32_t firstLed)
+{
+    LedLayoutGrid layoutGrid;
+    layoutGrid.firstLed = firstLed;
+    layoutGrid.isZigzag = grid.isZigzag;
+    /// truncated the same way as points in sample table
+    auto toPixel = [](float coord) { return static_cast<int32_t>(coord); };
+    std::transform(grid.runX.begin(), grid.runX.end(), std::back_inserter(layoutGrid.runX),
+                   toPixel);
+    std::transform(grid.ledY.begin(), grid.ledY.end(), std::back_inserter(layoutGrid.ledY),
+                   toPixel);
+    return layoutGrid;
+}
+
+/// build sample table for points that are not covered by layout grids
+static void CompileLayoutSamples(LedLayout &layout)
+{
+    const auto size = std::min<size_t>(layout.points.size(), layout.totalLeds);
+    vector<bool> inGrid(size, false);
+    for (const auto &grid : layout.grids) {
+        auto end = std::min<size_t>(size, grid.firstLed + grid.size());
+        std::fill(inGrid.begin() + std::min<size_t>(grid.firstLed, end), inGrid.begin() + end,
+                  true);
+    }
+
+    /// code in high bits, led in low bits keeps wiring order for equal codes
+    vector<uint64_t> keys;
+    keys.reserve(size);
+    for (uint32_t led = 0; led < size; ++led) {
+        if (inGrid[led])
+            continue;
+        const auto &point = layout.points[led];
+        auto code = MortonCode(static_cast<int32_t>(point.x), static_cast<int32_t>(point.y));
+        keys.push_back((static_cast<uint64_t>(code) << 32) | led);
+    }
+    std::sort(keys.begin(), keys.end());
+
+    layout.samples.resize(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        auto led = static_cast<uint32_t>(keys[i]);
+        const auto &point = layout.points[led];
+        layout.samples[i] = { static_cast<int32_t>(point.x), static_cast<int32_t>(point.y), led };
+    }
+    layout.isGatherCompiled = true;
+}
+
+/// Sample grid row by row: source is read along rows, LEDs of the row are written with
+/// fixed stride of run length, zigzag only flips index inside run. No per LED table reads
+static void GatherGrid(const LedLayoutGrid &grid, const unsigned char *data, int width,
+                       int height, size_t numChannels, const std::array<int, 3> &order, char *out)
+{
+    const size_t runs = grid.runX.size(), runLength = grid.ledY.size();
+    if (runs == 0 || runLength == 0)
+        return;
+
+    /// clamp columns once per frame, off-frame LEDs read frame edge
+    vector<size_t> columnOffsets(runs);
+    for (size_t run = 0; run < runs; ++run)
+        columnOffsets[run] = std::min(std::max(grid.runX[run], 0), width - 1) * numChannels;
+
+    const int o0 = order[0], o1 = order[1], o2 = order[2];
+    const size_t runStride = runLength * 3;
+    char *first = out + static_cast<size_t>(grid.firstLed) * 3;
+    for (size_t led = 0; led < runLength; ++led) {
+        auto y = std::min(std::max(grid.ledY[led], 0), height - 1);
+        const auto *row = data + static_cast<size_t>(y) * width * numChannels;
+        char *forward = first + led * 3;
+        char *backward = first + (runLength - 1 - led) * 3;
+        for (size_t run = 0; run < runs; ++run) {
+            const auto *src = row + columnOffsets[run];
+            char *dst = (grid.isZigzag && run % 2 == 1 ? backward : forward) + run * runStride;
+            dst[0] = src[o0];
+            dst[1] = src[o1];
+            dst[2] = src[o2];
+        }
+    }
+}
+
+/// CPU counterpart of grab shader: sample pixels at LED positions, nearest pixel,
+/// clamped to frame edge, and pack them to channels in wiring order
+static ChannelsToPix GatherLayoutPixels(const LedLayout &layout, const ofPixels &pixels,
+                                        GRAB_COLOR_TYPE colorType, vector<char> &leds)
+{
+    leds.assign(layout.totalLeds * 3, 0);
+    const int width = pixels.getWidth();
+    const int height = pixels.getHeight();
+    const size_t numChannels = pixels.getNumChannels();
+
+    if (width > 0 && height > 0 && numChannels > 0) {
+        auto order = GetColorOrder(colorType);
+        /// grayscale frames repeat single channel
+        for (auto &channel : order)
+            channel = std::min<int>(channel, numChannels - 1);
+
+        const auto *data = pixels.getData();
+        char *out = leds.data();
+        auto gather = [&](int32_t x, int32_t y, size_t led) {
+            x = std::min(std::max(x, 0), width - 1);
+            y = std::min(std::max(y, 0), height - 1);
+            const auto *src = data + (static_cast<size_t>(y) * width + x) * numChannels;
+            char *dst = out + led * 3;
+            dst[0] = src[order[0]];
+            dst[1] = src[order[1]];
+            dst[2] = src[order[2]];
+        };
+
+        if (!layout.isGatherCompiled) {
+            for (size_t led = 0; led < layout.totalLeds; ++led) {
+                const auto &point = layout.points[led];
+                gather(static_cast<int32_t>(point.x), static_cast<int32_t>(point.y), led);
+            }
+        }
+        else {
+            for (const auto &grid : layout.grids)
+                GatherGrid(grid, data, width, height, numChannels, order, out);
+            for (const auto &sample : layout.samples)
+                gather(sample.x, sample.y, sample.led);
+        }
+    }
+
+    ChannelsToPix output(layout.channelsTotalLeds.size());
+    auto it = leds.cbegin();
+    for (size_t chan = 0; chan < output.size(); ++chan) {
+        auto size = layout.channelsTotalLeds[chan] * 3;
+        output[chan].assign(it, it + size);
+        it += size;
+    }
+    return output;
+}
+
+} // namespace LedMapper
@@ -0,0 +1,318 @@
+/*
+ Copyright (C) 2017 Timofey Tavlintsev [http://tvl.io]
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+
+#include "ofxLedLayoutBin.h"
+
+#ifdef TARGET_WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace LedMapper {
+
+static_assert(sizeof(ofVec2f) == 2 * sizeof(float), "ofVec2f is stored as float pairs");
+
+bool ofxLedLayoutBin::open(const string &path)
+{
+    close();
+
+    auto filePath = ofToDataPath(path);
+
+#ifdef TARGET_WIN32
+    m_file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                         FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (m_file == INVALID_HANDLE_VALUE) {
+        m_file = nullptr;
+        return false;
+    }
+    LARGE_INTEGER size;
+    GetFileSizeEx(m_file, &size);
+    m_size = static_cast<size_t>(size.QuadPart);
+    if (m_size > 0)
+        m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m_mapping != nullptr)
+        m_data = static_cast<const char *>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+    int fd = ::open(filePath.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        m_size = static_cast<size_t>(st.st_size);
+        void *data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED)
+            m_data = static_cast<const char *>(data);
+    }
+    ::close(fd);
+#endif
+
+    if (m_data == nullptr) {
+        ofLogError() << "[ofxLedLayoutBin] Can't map file=" << filePath;
+        close();
+        return false;
+    }
+
+    /// validate table sizes once, so reads don't need bounds checks
+    bool valid = m_size >= sizeof(Header) && header()->magic == s_magic
+                 && header()->version == s_version;
+    if (valid) {
+        uint64_t expected = sizeof(Header)
+                            + uint64_t(header()->numControllers) * sizeof(Controller)
+                            + uint64_t(header()->numGrabs) * sizeof(Grab)
+                            + uint64_t(header()->numPoints) * sizeof(ofVec2f)
+                            + header()->settingsSize;
+        valid = expected == m_size;
+    }
+    for (size_t i = 0; valid && i < getNumControllers(); ++i) {
+        const auto &ctrl = controllers()[i];
+        valid = uint64_t(ctrl.firstGrab) + ctrl.numGrabs <= header()->numGrabs
+                && uint64_t(ctrl.settingsOffset) + ctrl.settingsSize <= header()->settingsSize;
+    }
+    for (size_t i = 0; valid && i < header()->numGrabs; ++i) {
+        const auto &grab = grabs()[i];
+        valid = uint64_t(grab.firstPoint) + grab.numControlPoints + grab.numLeds
+                <= header()->numPoints;
+    }
+
+    if (!valid) {
+        ofLogError() << "[ofxLedLayoutBin] Wrong or corrupted layout file=" << filePath;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void ofxLedLayoutBin::close()
+{
+#ifdef TARGET_WIN32
+    if (m_data != nullptr)
+        UnmapViewOfFile(m_data);
+    if (m_mapping != nullptr)
+        CloseHandle(m_mapping);
+    if (m_file != nullptr)
+        CloseHandle(m_file);
+    m_file = m_mapping = nullptr;
+#else
+    if (m_data != nullptr)
+        munmap(const_cast<char *>(m_data), m_size);
+#endif
+    m_data = nullptr;
+    m_size = 0;
+}
+
+size_t ofxLedLayoutBin::getNumControllers() const
+{
+    return isOpen() ? header()->numControllers : 0;
+}
+
+unsigned int ofxLedLayoutBin::getControllerId(size_t index) const
+{
+    assert(index < getNumControllers());
+    return controllers()[index].id;
+}
+
+ofxLedLayoutBin::ConfigStamp ofxLedLayoutBin::GetConfigStamp(const string &path)
+{
+    ConfigStamp stamp;
+    auto filePath = ofToDataPath(path);
+    std::error_code sizeErr, timeErr;
+    auto size = std::filesystem::file_size(filePath, sizeErr);
+    auto time = std::filesystem::last_write_time(filePath, timeErr);
+    if (sizeErr || timeErr)
+        return stamp;
+
+    uint64_t ticks = time.time_since_epoch().count();
+    stamp.size = static_cast<uint32_t>(size);
+    stamp.timeLow = static_cast<uint32_t>(ticks);
+    stamp.timeHigh = static_cast<uint32_t>(ticks >> 32);
+    return stamp;
+}
+
+ofxLedLayoutBin::ConfigStamp ofxLedLayoutBin::getConfigStamp(size_t index) const
+{
+    assert(index < getNumControllers());
+    return controllers()[index].configStamp;
+}
+
+bool ofxLedLayoutBin::readController(size_t index, LedControllerConfig &config) const
+{
+    if (index >= getNumControllers())
+        return false;
+
+    const auto &ctrl = controllers()[index];
+    config.id = ctrl.id;
+    config.outputType = static_cast<LedOutputType>(ctrl.outputType);
+
+    try {
+        const char *settingsBegin = settings() + ctrl.settingsOffset;
+        config.settings = ofJson::parse(settingsBegin, settingsBegin + ctrl.settingsSize);
+    }
+    catch (std::exception &ex) {
+        ofLogError() << "[ofxLedLayoutBin] Parse settings of controller=" << ctrl.id
+                     << " failed with:" << ex.what();
+        return false;
+    }
+
+    auto output = CreateLedOutput(config.outputType);
+    config.channelGrabObjects.assign(LedOutputGetChannels(output).size(), {});
+    config.grabPool.clear();
+    config.grabPool.reserve(ctrl.numGrabs);
+
+    LedGrabDesc desc;
+    for (uint32_t i = ctrl.firstGrab; i < ctrl.firstGrab + ctrl.numGrabs; ++i) {
+        const Grab *grab = grabs() + i;
+        if (grab->channel < 0
+            || static_cast<size_t>(grab->channel) >= config.channelGrabObjects.size())
+            continue;
+
+        const ofVec2f *grabPoints = points() + grab->firstPoint;
+        desc.type = static_cast<LMGrabType>(grab->type);
+        desc.channel = grab->channel;
+        desc.from = ofVec2f(grab->fromX, grab->fromY);
+        desc.to = ofVec2f(grab->toX, grab->toY);
+        desc.startAngle = grab->startAngle;
+        desc.isDouble = grab->flags & GRAB_FLAG_DOUBLE;
+        desc.isClockwise = grab->flags & GRAB_FLAG_CLOCKWISE;
+        desc.isVertical = grab->flags & GRAB_FLAG_VERTICAL;
+        desc.isZigzag = grab->flags & GRAB_FLAG_ZIGZAG;
+        desc.isBezier = grab->flags & GRAB_FLAG_BEZIER;
+        desc.hasColorCorrection = grab->flags & GRAB_FLAG_COLOR_CORRECTION;
+        if (desc.hasColorCorrection) {
+            desc.colorCorrection.gamma = grab->gamma;
+            desc.colorCorrection.brightness = grab->brightness;
+            std::copy(grab->whiteBalance, grab->whiteBalance + 3,
+                      desc.colorCorrection.whiteBalance.begin());
+        }
+        desc.points.assign(grabPoints, grabPoints + grab->numControlPoints);
+
+        auto handle = config.grabPool.restore(desc, ctrl.pixelsInLed,
+                                              grabPoints + grab->numControlPoints, grab->numLeds);
+        if (!handle.isValid())
+            continue;
+
+        auto &channel = config.channelGrabObjects[grab->channel];
+        config.grabPool[handle]->setObjectId(channel.size());
+        channel.emplace_back(handle);
+    }
+    return true;
+}
+
+bool ofxLedLayoutBin::Write(const string &path,
+                            const vector<shared_ptr<const LedControllerConfig>> &configs)
+{
+    /// stamps are read where WriteFileAtomic writes
+    auto folder = std::filesystem::path(ofToDataPath(path)).parent_path();
+    vector<Controller> ctrlTable;
+    vector<Grab> grabTable;
+    vector<ofVec2f> pointTable;
+    string settingsBlob;
+
+    for (const auto &config : configs) {
+        const auto &json = config->settings;
+        auto settingsStr = json.dump();
+
+        Controller ctrlEntry;
+        ctrlEntry.id = config->id;
+        ctrlEntry.outputType = config->outputType;
+        ctrlEntry.firstGrab = grabTable.size();
+        ctrlEntry.settingsOffset = settingsBlob.size();
+        ctrlEntry.settingsSize = settingsStr.size();
+        ctrlEntry.pixelsInLed = json.count("pixInLed") ? json.at("pixInLed").get<float>() : 2.f;
+        ctrlEntry.configStamp = GetConfigStamp(
+            (folder / (LCFileName + ofToString(config->id) + ".json")).string());
+        settingsBlob += settingsStr;
+
+        for (const auto &channel : config->channelGrabObjects) {
+            for (auto handle : channel) {
+                const auto *grab = config->grabPool[handle];
+                auto desc = grab->toDesc();
+                /// points grab leds are its coordinates, only path keeps control points
+                if (desc.type != LMGrabType::GRAB_PATH)
+                    desc.points.clear();
+
+                Grab grabEntry;
+                grabEntry.type = desc.type;
+                grabEntry.channel = desc.channel;
+                grabEntry.fromX = desc.from.x;
+                grabEntry.fromY = desc.from.y;
+                grabEntry.toX = desc.to.x;
+                grabEntry.toY = desc.to.y;
+                grabEntry.startAngle = desc.startAngle;
+                grabEntry.flags = (desc.isDouble ? GRAB_FLAG_DOUBLE : GRAB_FLAG_NONE)
+                                  | (desc.isClockwise ? GRAB_FLAG_CLOCKWISE : GRAB_FLAG_NONE)
+                                  | (desc.isVertical ? GRAB_FLAG_VERTICAL : GRAB_FLAG_NONE)
+                                  | (desc.isZigzag ? GRAB_FLAG_ZIGZAG : GRAB_FLAG_NONE)
+                                  | (desc.isBezier ? GRAB_FLAG_BEZIER : GRAB_FLAG_NONE)
+                                  | (desc.hasColorCorrection ? GRAB_FLAG_COLOR_CORRECTION
+                                                             : GRAB_FLAG_NONE);
+                grabEntry.gamma = desc.colorCorrection.gamma;
+                grabEntry.brightness = desc.colorCorrection.brightness;
+                std::copy(desc.colorCorrection.whiteBalance.begin(),
+                          desc.colorCorrection.whiteBalance.end(), grabEntry.whiteBalance);
+                grabEntry.firstPoint = pointTable.size();
+                grabEntry.numControlPoints = desc.points.size();
+                grabEntry.numLeds = grab->points().size();
+                grabTable.push_back(grabEntry);
+
+                pointTable.insert(pointTable.end(), desc.points.begin(), desc.points.end());
+                pointTable.insert(pointTable.end(), grab->points().begin(), grab->points().end());
+            }
+        }
+        ctrlEntry.numGrabs = grabTable.size() - ctrlEntry.firstGrab;
+        ctrlTable.push_back(ctrlEntry);
+    }
+
+    Header header;
+    header.magic = s_magic;
+    header.version = s_version;
+    header.numControllers = ctrlTable.size();
+    header.numGrabs = grabTable.size();
+    header.numPoints = pointTable.size();
+    header.settingsSize = settingsBlob.size();
+
+    bool result = WriteFileAtomic(path, [&](ostream &file) {
+        file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char *>(ctrlTable.data()),
+                   ctrlTable.size() * sizeof(Controller));
+        file.write(reinterpret_cast<const char *>(grabTable.data()),
+                   grabTable.size() * sizeof(Grab));
+        file.write(reinterpret_cast<const char *>(pointTable.data()),
+                   pointTable.size() * sizeof(ofVec2f));
+        file.write(settingsBlob.data(), settingsBlob.size());
+        return bool(file);
+    });
+
+    if (!result) {
+        ofLogError() << "[ofxLedLayoutBin] Failed writing layout file=" << path;
+        return false;
+    }
+    ofLogNotice() << "[ofxLedLayoutBin] Save " << header.numControllers << " controllers, "
+                  << header.numPoints << " points to " << path;
+    return true;
+}
+
+} // namespace LedMapper
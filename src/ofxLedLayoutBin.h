@@ -0,0 +1,139 @@
+/*
+ Copyright (C) 2017 Timofey Tavlintsev [http://tvl.io]
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+
+#pragma once
+
+#include "ofxLedController.h"
+
+namespace LedMapper {
+
+/// Compiled layout of all controllers, written next to Ctrl-N.json files on save.
+/// Json stays editable source, binary is used for startup only while Ctrl-N files in folder
+/// are exactly those it was compiled from, with same size and modification time.
+/// File is mapped into memory, grabs are restored from precomputed led coordinates
+/// without regenerating points. Layout (little-endian, 4 byte fields):
+///     Header
+///     Controller[numControllers]
+///     Grab[numGrabs]
+///     float x,y [numPoints]   per grab: path control points, then leds
+///     char [settingsSize]     per controller json settings without grabs
+class ofxLedLayoutBin {
+public:
+    ofxLedLayoutBin() = default;
+    ofxLedLayoutBin(const ofxLedLayoutBin &) = delete;
+    ofxLedLayoutBin &operator=(const ofxLedLayoutBin &) = delete;
+    ~ofxLedLayoutBin() { close(); }
+
+    /// map file and validate tables, returns false on missing or corrupt file,
+    /// path is resolved with ofToDataPath as Write does
+    bool open(const string &path);
+    void close();
+    bool isOpen() const { return m_data != nullptr; }
+
+    size_t getNumControllers() const;
+    unsigned int getControllerId(size_t index) const;
+    /// fill config of controller at index, grabs are restored with their points
+    bool readController(size_t index, LedControllerConfig &config) const;
+
+    /// size and modification time of Ctrl-N.json, layout is stale when they change
+    struct ConfigStamp {
+        uint32_t size = 0, timeLow = 0, timeHigh = 0;
+
+        bool operator==(const ConfigStamp &other) const
+        {
+            return size == other.size && timeLow == other.timeLow && timeHigh == other.timeHigh;
+        }
+        bool operator!=(const ConfigStamp &other) const { return !(*this == other); }
+        bool isValid() const { return *this != ConfigStamp(); }
+    };
+    /// zero stamp when file is missing, path is relative to data folder like other configs
+    static ConfigStamp GetConfigStamp(const string &path);
+    /// stamp of config file controller at index was compiled from
+    ConfigStamp getConfigStamp(size_t index) const;
+
+    /// write controllers snapshot, see ofxLedController::getConfigSnapshot,
+    /// Ctrl-N.json configs in same folder must be written before
+    static bool Write(const string &path,
+                      const vector<shared_ptr<const LedControllerConfig>> &configs);
+
+    static constexpr uint32_t s_magic = 0x4e424d4c; /// "LMBN"
+    static constexpr uint32_t s_version = 3;
+
+    enum GrabFlags : uint32_t {
+        GRAB_FLAG_NONE = 0,
+        GRAB_FLAG_DOUBLE = 1,
+        GRAB_FLAG_CLOCKWISE = 2,
+        GRAB_FLAG_VERTICAL = 4,
+        GRAB_FLAG_ZIGZAG = 8,
+        GRAB_FLAG_BEZIER = 16,
+        GRAB_FLAG_COLOR_CORRECTION = 32
+    };
+
+    struct Header {
+        uint32_t magic, version;
+        uint32_t numControllers, numGrabs, numPoints, settingsSize;
+    };
+    struct Controller {
+        uint32_t id, outputType;
+        uint32_t firstGrab, numGrabs;
+        uint32_t settingsOffset, settingsSize;
+        float pixelsInLed;
+        ConfigStamp configStamp;
+    };
+    struct Grab {
+        uint32_t type;
+        int32_t channel;
+        float fromX, fromY, toX, toY, startAngle;
+        uint32_t flags;
+        uint32_t firstPoint, numControlPoints, numLeds;
+        /// valid with GRAB_FLAG_COLOR_CORRECTION
+        float gamma, brightness, whiteBalance[3];
+    };
+
+private:
+    const Header *header() const { return reinterpret_cast<const Header *>(m_data); }
+    const Controller *controllers() const
+    {
+        return reinterpret_cast<const Controller *>(m_data + sizeof(Header));
+    }
+    const Grab *grabs() const
+    {
+        return reinterpret_cast<const Grab *>(controllers() + header()->numControllers);
+    }
+    const ofVec2f *points() const
+    {
+        return reinterpret_cast<const ofVec2f *>(grabs() + header()->numGrabs);
+    }
+    const char *settings() const
+    {
+        return reinterpret_cast<const char *>(points() + header()->numPoints);
+    }
+
+    const char *m_data = nullptr;
+    size_t m_size = 0;
+#ifdef TARGET_WIN32
+    void *m_file = nullptr, *m_mapping = nullptr;
+#endif
+};
+
+} // namespace LedMapper
@@ -21,21 +21,67 @@
  */
 
 #include "ofxLedMapper.h"
+#include "grab/ofxLedGrabPixelMapLoad.h"
+#include "ofxLedLayoutBin.h"
+#include <atomic>
 #include <math.h>
 #include <regex>
+#include <set>
+#include <thread>
 
 namespace LedMapper {
 
+/// Modification times of controller configs and compiled layout in folder
+static map<string, std::filesystem::file_time_type> GetConfigFilesTimes(const string &folder)
+{
+    map<string, std::filesystem::file_time_type> filesTimes;
+    std::error_code err;
+    for (const auto &entry : std::filesystem::directory_iterator(ofToDataPath(folder), err)) {
+        auto name = entry.path().filename().string();
+        if (name.compare(0, LCFileName.size(), LCFileName) != 0 && name != LMLayoutBinFileName)
+            continue;
+        filesTimes[name] = std::filesystem::last_write_time(entry.path(), err);
+    }
+    return filesTimes;
+}
+
+/// Run func for every index in [0, count) on hardware threads, returns when all are done.
+/// func must not throw, exception escaping worker thread terminates app
+static void ParallelFor(size_t count, const function<void(size_t)> &func)
+{
+    size_t numThreads = std::min<size_t>(count, std::max(1u, thread::hardware_concurrency()));
+    atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (size_t i = next++; i < count; i = next++)
+            func(i);
+    };
+
+    vector<thread> threads;
+    for (size_t i = 1; i < numThreads; ++i)
+        threads.emplace_back(worker);
+    worker();
+    for (auto &t : threads)
+        t.join();
+}
+
 ofxLedMapper::ofxLedMapper()
-    : m_bSetup(false)
+    : m_currentCtrl(0)
+    , m_configFolderPath(LedMapper::LM_CONFIG_PATH)
+    , m_bAutoReload(false)
+    , m_bSavePending(false)
+    , m_autoReloadInterval(1000)
+    , m_lastConfigCheckTime(0)
+    , m_bSetup(false)
     , m_grabTypeSelected(LMGrabType::GRAB_SELECT)
-    , m_currentCtrl(0)
+    , m_copyPasteOffset(0.f)
 #ifndef LED_MAPPER_NO_GUI
     , m_gui(nullptr)
     , m_guiController(nullptr)
     , m_iconsMenu(nullptr)
+    , m_toggleRecord(nullptr)
+    , m_togglePlayback(nullptr)
+    , m_sliderFadeTime(nullptr)
 #endif
-    , m_configFolderPath(LedMapper::LM_CONFIG_PATH)
 {
     /// Disable all textures be rect
     // ofDisableArbTex();
@@ -51,6 +97,7 @@ ofxLedMapper::ofxLedMapper()
 
     /// add default ctrl
     add(0, LedOutputTypeLedmap, m_configFolderPath);
+    m_savedPlaylist = m_playlist.toJson();
 
     m_bSetup = true;
 }
@@ -69,15 +116,26 @@ ofxLedMapper::~ofxLedMapper()
 
 void ofxLedMapper::update()
 {
+    for (auto &ctrl : m_controllers) {
+        /// publish layouts edited since last frame before output reads them
+        ctrl.second->updateGrabPoints();
+        ctrl.second->releaseIfIdle();
+    }
+    checkConfigFiles();
+
     if (!m_bSetup || !m_gui->getVisible())
         return;
 
 #ifndef LED_MAPPER_NO_GUI
     m_gui->update();
     m_listControllers->update();
+    m_listPlaylist->update();
     m_iconsMenu->update();
-    if (m_guiController != nullptr)
+    if (m_guiController != nullptr && m_controllers.count(m_currentCtrl)) {
+        /// output settings of bound controller change in gui events
+        auto lock = m_controllers.at(m_currentCtrl)->lockOutput();
         m_guiController->update();
+    }
 #endif
 }
 
@@ -106,6 +164,7 @@ void ofxLedMapper::drawGui()
     m_gui->draw();
 
     m_listControllers->draw();
+    m_listPlaylist->draw();
 
     m_iconsMenu->draw();
     if (m_guiController != nullptr)
@@ -130,6 +189,144 @@ void ofxLedMapper::send(const ofTexture &texIn)
     }
 }
 
+void ofxLedMapper::send(const vector<LedSourceLayer> &layers)
+{
+#ifndef LED_MAPPER_NO_GUI
+    /// Send only to selected controller when Debug Toggle enabled
+    if (m_toggleDebugController->getChecked()) {
+        m_controllers.at(m_currentCtrl)->send(layers);
+        return;
+    }
+    if (m_togglePlay->getChecked())
+#endif
+    {
+        for (auto &ctrl : m_controllers) {
+            ctrl.second->send(layers);
+        }
+    }
+}
+
+void ofxLedMapper::send(const LedSources &sources)
+{
+    static const vector<LedSourceLayer> s_noLayers;
+    auto findLayers = [&sources](const string &name) -> const vector<LedSourceLayer> & {
+        auto source = sources.find(name);
+        return source != sources.end() ? source->second : s_noLayers;
+    };
+    /// controllers bound to default source play cues, fade progress is taken by controller
+    /// when it samples frame
+    auto fade = m_playlist.getFade();
+    const auto &fadeFrom = fade.hasFrom ? findLayers(fade.from) : s_noLayers;
+    auto sendSource = [&](ofxLedController &ctrl) {
+        if (ctrl.getSource().empty() && m_playlist.getCurrent() >= 0) {
+            ctrl.send(fadeFrom, findLayers(fade.to), fade);
+            return;
+        }
+        const auto &layers = findLayers(ctrl.getSource());
+        if (!layers.empty())
+            ctrl.send(layers);
+    };
+#ifndef LED_MAPPER_NO_GUI
+    /// Send only to selected controller when Debug Toggle enabled
+    if (m_toggleDebugController->getChecked()) {
+        sendSource(*m_controllers.at(m_currentCtrl));
+        return;
+    }
+    if (m_togglePlay->getChecked())
+#endif
+    {
+        for (auto &ctrl : m_controllers) {
+            sendSource(*ctrl.second);
+        }
+    }
+}
+
+bool ofxLedMapper::goCue(size_t index)
+{
+    if (!m_playlist.go(index, ofGetElapsedTimeMicros()))
+        return false;
+    updatePlaylistGui();
+    return true;
+}
+
+bool ofxLedMapper::nextCue()
+{
+    if (!m_playlist.next(ofGetElapsedTimeMicros()))
+        return false;
+    updatePlaylistGui();
+    return true;
+}
+
+bool ofxLedMapper::startRecording(string folderPath)
+{
+    if (folderPath.empty())
+        folderPath = ofFilePath::join(m_configFolderPath, LMCaptureFolder);
+    if (!ofDirectory::doesDirectoryExist(folderPath))
+        ofDirectory::createDirectory(folderPath, true, true);
+
+    stopRecording();
+    for (auto &ctrl : m_controllers) {
+        string path = ofFilePath::join(folderPath, LMCaptureFileName + ofToString(ctrl.first)
+                                                       + LMCaptureFileExt);
+        if (!ctrl.second->startRecording(path)) {
+            stopRecording();
+            return false;
+        }
+    }
+    ofLogNotice() << "[ofxLedMapper] Recording to " << folderPath;
+    return true;
+}
+
+void ofxLedMapper::stopRecording()
+{
+    for (auto &ctrl : m_controllers)
+        ctrl.second->stopRecording();
+}
+
+bool ofxLedMapper::isRecording() const
+{
+    return any_of(m_controllers.begin(), m_controllers.end(),
+                  [](const auto &ctrl) { return ctrl.second->isRecording(); });
+}
+
+bool ofxLedMapper::startPlayback(string folderPath, bool loop)
+{
+    if (folderPath.empty())
+        folderPath = ofFilePath::join(m_configFolderPath, LMCaptureFolder);
+
+    stopPlayback();
+    /// all captures start from same time
+    auto startTime = ofGetElapsedTimeMicros();
+    size_t played = 0;
+    for (auto &ctrl : m_controllers) {
+        string path = ofFilePath::join(folderPath, LMCaptureFileName + ofToString(ctrl.first)
+                                                       + LMCaptureFileExt);
+        if (ofFile::doesFileExist(path) && ctrl.second->startPlayback(path, loop, startTime))
+            ++played;
+    }
+    ofLogNotice() << "[ofxLedMapper] Playback of " << played << " controllers from "
+                  << folderPath;
+    return played > 0;
+}
+
+void ofxLedMapper::stopPlayback()
+{
+    for (auto &ctrl : m_controllers)
+        ctrl.second->stopPlayback();
+}
+
+void ofxLedMapper::seekPlayback(uint64_t time)
+{
+    for (auto &ctrl : m_controllers)
+        ctrl.second->seekPlayback(time);
+}
+
+bool ofxLedMapper::isPlaying() const
+{
+    return any_of(m_controllers.begin(), m_controllers.end(),
+                  [](const auto &ctrl) { return ctrl.second->isPlaying(); });
+}
+
 bool ofxLedMapper::add(LedOutputType type, string folder_path)
 {
     add(m_controllers.size(), type, folder_path);
@@ -142,7 +339,13 @@ bool ofxLedMapper::add(unsigned int _ctrlId, LedOutputType type, const string &f
     while (!checkUniqueId(ctrlId)) {
         ctrlId++;
     }
-    auto ctrl = make_unique<ofxLedController>(ctrlId, type, folder_path);
+    addController(make_unique<ofxLedController>(ctrlId, type, folder_path));
+    return true;
+}
+
+void ofxLedMapper::addController(unique_ptr<ofxLedController> ctrl)
+{
+    auto ctrlId = ctrl->getId();
     ctrl->disableEvents();
 #ifndef LED_MAPPER_NO_GUI
     function<void(void)> fnc = [this](void) { this->updateControllersListGui(); };
@@ -151,8 +354,6 @@ bool ofxLedMapper::add(unsigned int _ctrlId, LedOutputType type, const string &f
 #endif
 
     m_controllers[ctrlId] = move(ctrl);
-
-    return true;
 }
 
 bool ofxLedMapper::remove(unsigned int _ctrlId)
@@ -176,6 +377,67 @@ bool ofxLedMapper::remove(unsigned int _ctrlId)
     return true;
 }
 
+bool ofxLedMapper::addGrabs(unsigned int _ctrlId, const vector<LedGrabDesc> &descs,
+                            bool replaceExisting)
+{
+    auto it = m_controllers.find(_ctrlId);
+    if (it == m_controllers.end()) {
+        ofLogError() << "[ofxLedMapper] no ctrl to add grabs with id=" << _ctrlId;
+        return false;
+    }
+    return it->second->addGrabs(descs, replaceExisting);
+}
+
+bool ofxLedMapper::importPixelMap(const string &path, LedOutputType type)
+{
+    auto output = CreateLedOutput(type);
+    size_t channels = LedOutputGetChannels(output).size();
+    size_t maxPixInChannel = LedOutputGetMaxPixels(output) / channels;
+
+    /// channels are numbered through all new controllers, descriptions of one controller are
+    /// collected and moved into it as soon as map goes to the next one
+    vector<unsigned int> created;
+    vector<LedGrabDesc> ctrlDescs;
+
+    auto flush = [&]() {
+        if (ctrlDescs.empty())
+            return true;
+        /// empty config of type, leftover Ctrl-N file of the id must not change output
+        /// that channels were split for
+        LedControllerConfig config;
+        config.id = m_controllers.empty() ? 0 : m_controllers.rbegin()->first + 1;
+        config.outputType = type;
+        config.channelGrabObjects.resize(channels);
+        unsigned int ctrlId = config.id;
+        addController(make_unique<ofxLedController>(move(config), m_configFolderPath));
+        created.emplace_back(ctrlId);
+        bool result = m_controllers.at(ctrlId)->addGrabs(move(ctrlDescs), true);
+        ctrlDescs.clear();
+        return result;
+    };
+
+    size_t ctrlNum = 0;
+    bool result = ParsePixelMapToGrabDescs(
+        path, maxPixInChannel, numeric_limits<size_t>::max(), [&](LedGrabDesc &&desc) {
+            if (desc.channel / channels != ctrlNum) {
+                if (!flush())
+                    return false;
+                ctrlNum = desc.channel / channels;
+            }
+            desc.channel %= channels;
+            ctrlDescs.emplace_back(move(desc));
+            return true;
+        });
+    result = result && flush();
+
+    /// don't leave half imported map
+    if (!result) {
+        for (auto ctrlId : created)
+            remove(ctrlId);
+    }
+    return result;
+}
+
 // Return true if ID not found
 bool ofxLedMapper::checkUniqueId(unsigned int _ctrlId)
 {
@@ -209,6 +471,21 @@ void ofxLedMapper::setupGui()
 
     m_toggleDebugController = m_gui->addToggle(LMGUIToggleDebug, false);
 
+    m_toggleRecord = m_gui->addToggle(LMGUIToggleRecord, false);
+    m_toggleRecord->onToggleEvent([this](ofxDatGuiToggleEvent e) {
+        if (!e.checked)
+            this->stopRecording();
+        else if (!this->startRecording())
+            m_toggleRecord->setChecked(false);
+    });
+    m_togglePlayback = m_gui->addToggle(LMGUITogglePlayback, false);
+    m_togglePlayback->onToggleEvent([this](ofxDatGuiToggleEvent e) {
+        if (!e.checked)
+            this->stopPlayback();
+        else if (!this->startPlayback())
+            m_togglePlayback->setChecked(false);
+    });
+
     m_gui->addButton(LMGUIButtonAddLedmap)->onButtonEvent([this](ofxDatGuiButtonEvent) {
         this->add(LedOutputTypeLedmap, m_configFolderPath);
     });
@@ -228,6 +505,31 @@ void ofxLedMapper::setupGui()
     m_listControllers->setWidth(LM_GUI_WIDTH);
     m_listControllers->setBackgroundColor(ofColor(30));
 
+    m_gui->addHeader(LMGUIPlayer, false);
+    m_gui->addButton(LMGUIButtonNextCue)->onButtonEvent([this](ofxDatGuiButtonEvent) {
+        this->nextCue();
+    });
+    m_sliderFadeTime = m_gui->addSlider(LMGUISliderFadeTime, 0, 30);
+    m_sliderFadeTime->setPrecision(1);
+    m_sliderFadeTime->setValue(1);
+    m_sliderFadeTime->onSliderEvent([this](ofxDatGuiSliderEvent e) {
+        if (auto cue = m_playlist.getCue(m_playlist.getCurrent()))
+            cue->fadeTime = e.value;
+    });
+    m_gui->addButton(LMGUIListPlaylistDelete)->onButtonEvent([this](ofxDatGuiButtonEvent) {
+        if (m_playlist.getCurrent() >= 0)
+            m_playlist.remove(m_playlist.getCurrent());
+        this->updatePlaylistGui();
+    });
+
+    m_listPlaylist = make_unique<ofxDatGuiScrollView>(LMGUIListPlaylist, 5);
+    m_listPlaylist->setTheme(m_guiTheme.get());
+    m_listPlaylist->onScrollViewEvent([this](ofxDatGuiScrollViewEvent e) {
+        this->goCue(static_cast<size_t>(e.index));
+    });
+    m_listPlaylist->setWidth(LM_GUI_WIDTH);
+    m_listPlaylist->setBackgroundColor(ofColor(30));
+
     m_gui->update();
 
     /// Mouse Grab style buttons avalable when controllers tab selected
@@ -261,10 +563,11 @@ void ofxLedMapper::setGuiPosition(int x, int y)
 #ifndef LED_MAPPER_NO_GUI
     m_gui->setPosition(x, y);
     m_listControllers->setPosition(x, y + m_gui->getHeight());
+    m_listPlaylist->setPosition(x, m_listControllers->getY() + m_listControllers->getHeight());
     m_iconsMenu->setPosition(ofxDatGuiAnchor::BOTTOM_RIGHT);
     if (m_guiController)
-        m_guiController->setPosition(m_listControllers->getX(),
-                                     m_listControllers->getY() + m_listControllers->getHeight());
+        m_guiController->setPosition(m_listPlaylist->getX(),
+                                     m_listPlaylist->getY() + m_listPlaylist->getHeight());
 #endif
 }
 void ofxLedMapper::setGuiActive(bool active)
@@ -332,6 +635,24 @@ void ofxLedMapper::updateControllersListGui()
 #endif
 }
 
+/// rebuild cue list, current cue is highlighted
+void ofxLedMapper::updatePlaylistGui()
+{
+#ifndef LED_MAPPER_NO_GUI
+    m_listPlaylist->clear();
+    const auto &cues = m_playlist.getCues();
+    for (size_t i = 0; i < cues.size(); ++i) {
+        m_listPlaylist->add(cues[i].name.empty() ? cues[i].source : cues[i].name);
+        m_listPlaylist->get(static_cast<int>(i))
+            ->setBackgroundColor(static_cast<int>(i) == m_playlist.getCurrent()
+                                     ? ofColor::fromHex(LedMapper::LM_COLOR_GREEN)
+                                     : ofColor(30));
+    }
+    if (auto cue = m_playlist.getCue(m_playlist.getCurrent()))
+        m_sliderFadeTime->setValue(cue->fadeTime);
+#endif
+}
+
 //
 // ------------------------------ SAVE & LOAD ------------------------------
 //
@@ -344,6 +665,7 @@ bool ofxLedMapper::load(string folderPath)
 bool ofxLedMapper::load()
 {
     ofLogVerbose() << "[ofxLedMapper] Load from folder=" << m_configFolderPath;
+    m_saver.waitForSave();
     m_dir.open(m_configFolderPath);
     // check if dir exists, if not create dir and return
     if (!m_dir.exists()) {
@@ -369,17 +691,38 @@ bool ofxLedMapper::load()
 #endif
     }
 
-    regex ctrl_name(".*" + ofToString(LCFileName) + "([0-9]+).*"); // ([^\\.]+)
-    smatch base_match;
-    for (size_t i = 0; i < m_dir.size(); ++i) {
-        string pth = m_dir.getPath(i);
-        ofLogVerbose() << "[ofxLedMapper] Check file=" << pth;
-        regex_match(pth, base_match, ctrl_name);
-        if (base_match.size() > 1) {
-            ofLogVerbose("[ofxLedMapper] Load: add controller " + base_match[1].str());
-            add(ofToInt(base_match[1].str()), LedOutputTypeLedmap, m_configFolderPath);
-        }
+    auto startTime = ofGetElapsedTimeMicros();
+
+    /// parallel: read files, parse configs and generate grab points
+    vector<LedControllerConfig> configs;
+    vector<uint64_t> readTimes;
+    if (!readLayoutBin(configs, readTimes))
+        readJsonConfigs(configs, readTimes);
+    auto readTime = ofGetElapsedTimeMicros() - startTime;
+
+    /// serial: GL and network resources are created on main thread
+    for (size_t i = 0; i < configs.size(); ++i) {
+        auto ctrlStartTime = ofGetElapsedTimeMicros();
+        auto ctrlId = configs[i].id;
+        addController(make_unique<ofxLedController>(move(configs[i]), m_configFolderPath));
+        ofLogNotice() << "[ofxLedMapper] Load controller " << ctrlId << ": read "
+                      << readTimes[i] / 1000.f << "ms, setup "
+                      << (ofGetElapsedTimeMicros() - ctrlStartTime) / 1000.f << "ms, "
+                      << m_controllers.at(ctrlId)->getTotalLeds() << " leds";
     }
+    /// loaded controllers match files in folder
+    m_savedFolderPath = m_configFolderPath;
+    m_savedIds.clear();
+    for (auto &ctrl : m_controllers)
+        m_savedIds.insert(ctrl.first);
+
+    m_configFilesTimes = GetConfigFilesTimes(m_configFolderPath);
+    loadPlaylist();
+
+    ofLogNotice() << "[ofxLedMapper] Loaded " << m_controllers.size() << " controllers in "
+                  << (ofGetElapsedTimeMicros() - startTime) / 1000.f << "ms, read "
+                  << readTime / 1000.f << "ms";
+
     if (!m_controllers.empty()) {
 #ifndef LED_MAPPER_NO_GUI
         m_listControllers->sort();
@@ -392,6 +735,121 @@ bool ofxLedMapper::load()
     return false;
 }
 
+/// Read configs again and apply only differences, controllers that didn't change keep
+/// their output connection and GL resources
+bool ofxLedMapper::reload()
+{
+    m_saver.waitForSave();
+    m_dir.open(m_configFolderPath);
+    if (!m_dir.exists())
+        return false;
+    m_dir.listDir();
+    m_dir.sort();
+
+    auto startTime = ofGetElapsedTimeMicros();
+    vector<LedControllerConfig> configs;
+    vector<uint64_t> readTimes;
+    if (!readLayoutBin(configs, readTimes))
+        readJsonConfigs(configs, readTimes);
+
+    set<unsigned int> ids;
+    size_t added = 0, changed = 0, removed = 0;
+    bool currentChanged = false;
+    for (auto &config : configs) {
+        ids.insert(config.id);
+        auto it = m_controllers.find(config.id);
+        if (it == m_controllers.end()) {
+            addController(make_unique<ofxLedController>(move(config), m_configFolderPath));
+            ++added;
+            continue;
+        }
+        try {
+            if (it->second->applyConfigDiff(move(config))) {
+                ++changed;
+                currentChanged |= it->first == m_currentCtrl;
+            }
+        }
+        catch (std::exception &ex) {
+            ofLogError() << "[ofxLedMapper] Reload controller " << it->first
+                         << " failed with:" << ex.what();
+        }
+    }
+
+    vector<unsigned int> removedIds;
+    for (auto &ctrl : m_controllers)
+        if (!ids.count(ctrl.first))
+            removedIds.push_back(ctrl.first);
+    for (auto id : removedIds) {
+        remove(id);
+        ++removed;
+    }
+
+    m_savedFolderPath = m_configFolderPath;
+    m_savedIds = move(ids);
+    m_configFilesTimes = GetConfigFilesTimes(m_configFolderPath);
+
+    ofLogNotice() << "[ofxLedMapper] Reload: " << added << " added, " << changed << " changed, "
+                  << removed << " removed in " << (ofGetElapsedTimeMicros() - startTime) / 1000.f
+                  << "ms";
+
+    if (m_controllers.empty())
+        return false;
+#ifndef LED_MAPPER_NO_GUI
+    if (added > 0)
+        m_listControllers->sort();
+    /// rebind gui of current controller to show reloaded values
+    if (currentChanged && m_guiController != nullptr) {
+        m_controllers.at(m_currentCtrl)->setSelected(false);
+        m_guiController.reset();
+        setCurrentController(m_currentCtrl);
+    }
+#endif
+    return true;
+}
+
+void ofxLedMapper::setAutoReload(bool enable, uint64_t checkInterval)
+{
+    m_bAutoReload = enable;
+    m_autoReloadInterval = checkInterval;
+    m_configFilesTimes = GetConfigFilesTimes(m_configFolderPath);
+}
+
+/// Reload when config files were changed by someone else
+void ofxLedMapper::checkConfigFiles()
+{
+    auto now = ofGetElapsedTimeMillis();
+    if (!m_bAutoReload || now - m_lastConfigCheckTime < m_autoReloadInterval)
+        return;
+    m_lastConfigCheckTime = now;
+
+    /// own saves change files too, remember their times once written
+    if (m_saver.isSaving())
+        return;
+    auto filesTimes = GetConfigFilesTimes(m_configFolderPath);
+    if (m_bSavePending) {
+        m_bSavePending = false;
+        m_configFilesTimes = move(filesTimes);
+        return;
+    }
+
+    if (filesTimes == m_configFilesTimes)
+        return;
+
+    /// reload would drop edits that are not saved yet, user decides with save or load
+    bool hasUnsaved = m_savedIds.size() != m_controllers.size();
+    for (auto &ctrl : m_controllers)
+        hasUnsaved = hasUnsaved || !m_savedIds.count(ctrl.first) || ctrl.second->isConfigDirty();
+    if (hasUnsaved) {
+        ofLogWarning() << "[ofxLedMapper] Config files changed, but layout has unsaved edits, "
+                          "skip reload";
+        m_configFilesTimes = move(filesTimes);
+        return;
+    }
+
+    ofLogNotice() << "[ofxLedMapper] Config files changed, reload";
+    reload();
+}
+
 bool ofxLedMapper::save(string folderPath)
 {
     m_configFolderPath = folderPath;
@@ -405,31 +863,190 @@ bool ofxLedMapper::save()
     if (!m_dir.exists()) {
         m_dir.createDirectory(m_configFolderPath);
     }
-    else {
-        m_dir.listDir();
-        for (size_t i = 0; i < m_dir.size(); ++i) {
-            if (m_dir.getName(i).compare(0, LCFileName.size(), LCFileName) == 0)
-                std::filesystem::remove(m_dir.getPath(i));
-        }
+
+    /// everything is written after failed save or to another folder
+    bool saveAll = m_saver.checkFailed() || m_savedFolderPath != m_configFolderPath;
+    savePlaylist();
+
+    LedConfigSaveJob job;
+    job.folder = m_configFolderPath;
+    set<unsigned int> ids;
+    for (auto &ctrl : m_controllers) {
+        ids.insert(ctrl.second->getId());
+        if (saveAll || ctrl.second->isConfigDirty())
+            job.dirtyIds.insert(ctrl.second->getId());
+    }
+
+    if (job.dirtyIds.empty() && ids == m_savedIds) {
+        ofLogVerbose() << "[ofxLedMapper] Save: no changes";
+        return true;
     }
 
+    /// only copies of changed controllers are taken here, clean ones share snapshot of
+    /// previous save, serialization and writing are on saver thread
+    job.controllers.reserve(m_controllers.size());
     for (auto &ctrl : m_controllers) {
-        ctrl.second->save(m_configFolderPath);
+        job.controllers.emplace_back(ctrl.second->getSharedConfigSnapshot());
+        ctrl.second->markConfigSaved();
     }
 
+    m_savedIds = move(ids);
+    m_savedFolderPath = m_configFolderPath;
+    m_saver.save(move(job));
+    m_bSavePending = true;
     return true;
 }
-    
+
+void ofxLedMapper::loadPlaylist()
+{
+    string path = ofFilePath::addTrailingSlash(m_configFolderPath) + LMPlaylistFileName;
+    m_playlist.clear();
+    m_savedPlaylist = m_playlist.toJson();
+    if (ofFile::doesFileExist(path)) {
+        try {
+            m_playlist.fromJson(ofLoadJson(path));
+            m_savedPlaylist = m_playlist.toJson();
+        }
+        catch (std::exception &ex) {
+            ofLogError() << "[ofxLedMapper] Parse " << path << " failed with:" << ex.what();
+        }
+    }
+    updatePlaylistGui();
+}
+
+/// playlist is small, so it's written on caller thread and only when changed
+bool ofxLedMapper::savePlaylist()
+{
+    auto json = m_playlist.toJson();
+    if (json == m_savedPlaylist && m_savedFolderPath == m_configFolderPath)
+        return true;
+    string path = ofFilePath::addTrailingSlash(m_configFolderPath) + LMPlaylistFileName;
+    if (!WriteFileAtomic(path, [&json](ostream &out) { return bool(out << json.dump(4)); })) {
+        ofLogError() << "[ofxLedMapper] Can't save playlist to " << path;
+        return false;
+    }
+    m_savedPlaylist = move(json);
+    return true;
+}
+
+/// Read controllers from compiled layout if it was compiled from exactly the Ctrl-N files
+/// in folder, a config that was edited, added or deleted by hand makes json the source
+/// and layout is rebuilt on next save
+bool ofxLedMapper::readLayoutBin(vector<LedControllerConfig> &configs,
+                                 vector<uint64_t> &readTimes)
+{
+    string binPath = ofFilePath::addTrailingSlash(m_configFolderPath) + LMLayoutBinFileName;
+    ofxLedLayoutBin layout;
+    if (!layout.open(binPath))
+        return false;
+
+    map<string, string> configPaths;
+    for (size_t i = 0; i < m_dir.size(); ++i) {
+        if (m_dir.getName(i).compare(0, LCFileName.size(), LCFileName) == 0)
+            configPaths[m_dir.getName(i)] = m_dir.getPath(i);
+    }
+    bool isStale = configPaths.size() != layout.getNumControllers();
+    for (size_t i = 0; !isStale && i < layout.getNumControllers(); ++i) {
+        auto it = configPaths.find(LCFileName + ofToString(layout.getControllerId(i)) + ".json");
+        if (it == configPaths.end()) {
+            isStale = true;
+            break;
+        }
+        /// unreadable config gives zero stamp, which must not match zero stamp in layout
+        auto stamp = ofxLedLayoutBin::GetConfigStamp(it->second);
+        isStale = !stamp.isValid() || stamp != layout.getConfigStamp(i);
+    }
+    if (isStale) {
+        ofLogNotice() << "[ofxLedMapper] Configs changed since " << LMLayoutBinFileName
+                      << " was saved, load from json";
+        return false;
+    }
+
+    set<unsigned int> ids;
+    for (size_t i = 0; i < layout.getNumControllers(); ++i) {
+        if (!ids.insert(layout.getControllerId(i)).second) {
+            ofLogError() << "[ofxLedMapper] Duplicate controller id in " << binPath;
+            return false;
+        }
+    }
+
+    configs.resize(layout.getNumControllers());
+    readTimes.resize(configs.size());
+    atomic<bool> result(true);
+    ParallelFor(configs.size(), [&](size_t i) {
+        auto startTime = ofGetElapsedTimeMicros();
+        /// exception can't leave worker thread, it fails whole layout instead
+        try {
+            if (!layout.readController(i, configs[i]))
+                result = false;
+        }
+        catch (std::exception &ex) {
+            ofLogError() << "[ofxLedMapper] Read controller " << layout.getControllerId(i)
+                         << " from " << binPath << " failed with:" << ex.what();
+            result = false;
+        }
+        readTimes[i] = ofGetElapsedTimeMicros() - startTime;
+    });
+
+    if (!result) {
+        ofLogError() << "[ofxLedMapper] Wrong controller in " << binPath;
+        configs.clear();
+        readTimes.clear();
+    }
+    return result;
+}
+
+/// Read Ctrl-N.json (or .xml) configs of all controllers in folder
+void ofxLedMapper::readJsonConfigs(vector<LedControllerConfig> &configs,
+                                   vector<uint64_t> &readTimes)
+{
+    /// json and older xml config of same controller load as one
+    set<unsigned int> ids;
+    regex ctrl_name(".*" + ofToString(LCFileName) + "([0-9]+).*"); // ([^\\.]+)
+    smatch base_match;
+    for (size_t i = 0; i < m_dir.size(); ++i) {
+        string pth = m_dir.getPath(i);
+        ofLogVerbose() << "[ofxLedMapper] Check file=" << pth;
+        regex_match(pth, base_match, ctrl_name);
+        if (base_match.size() > 1) {
+            ofLogVerbose("[ofxLedMapper] Load: add controller " + base_match[1].str());
+            ids.insert(ofToInt(base_match[1].str()));
+        }
+    }
+
+    vector<unsigned int> idList(ids.begin(), ids.end());
+    configs.resize(idList.size());
+    readTimes.resize(idList.size());
+    ParallelFor(idList.size(), [&](size_t i) {
+        auto startTime = ofGetElapsedTimeMicros();
+        try {
+            configs[i] = ofxLedController::ReadConfig(idList[i], LedOutputTypeLedmap,
+                                                      m_configFolderPath);
+        }
+        catch (std::exception &ex) {
+            ofLogError() << "[ofxLedMapper] Read config of controller " << idList[i]
+                         << " failed with:" << ex.what();
+            configs[i] = {};
+            configs[i].id = idList[i];
+        }
+        readTimes[i] = ofGetElapsedTimeMicros() - startTime;
+    });
+}
+
 //
 // ------------------------------ COPY / PASTE ------------------------------
 //
 void ofxLedMapper::copyGrabs()
 {
     m_copyPasteGrabs.clear();
+    m_copyPastePool.clear();
+    m_copyPasteOffset = 0.f;
 
-    for (const auto &grab : m_controllers.at(m_currentCtrl)->peekCurrentGrabs()) {
+    const auto &ctrl = m_controllers.at(m_currentCtrl);
+    for (auto handle : ctrl->peekCurrentGrabs()) {
+        auto grab = ctrl->peekGrab(handle);
         if (grab->isSelected())
-            m_copyPasteGrabs.emplace_back(ofxLedController::GetUniqueTypedGrab(grab.get()));
+            m_copyPasteGrabs.emplace_back(m_copyPastePool.clone(*grab));
     }
     ofLogVerbose() << "Copied controller #" << m_currentCtrl
                    << " grabs, size=" << m_copyPasteGrabs.size();
@@ -441,11 +1058,14 @@ void ofxLedMapper::pasteGrabs()
         return;
     /// deselect currently selected
     m_controllers.at(m_currentCtrl)->setGrabsSelected(false);
-    for (auto &grab : m_copyPasteGrabs) {
-        grab->set(grab->getFrom() + ofVec2f(20), grab->getTo() + ofVec2f(20));
-        ofLogVerbose() << "Pasting Grab: " << *grab;
-        m_controllers.at(m_currentCtrl)->addGrab(ofxLedController::GetUniqueTypedGrab(grab.get()));
-    }
+
+    /// every next paste is shifted from previous one
+    m_copyPasteOffset += 20.f;
+    vector<const ofxLedGrab *> grabs;
+    grabs.reserve(m_copyPasteGrabs.size());
+    for (auto handle : m_copyPasteGrabs)
+        grabs.push_back(m_copyPastePool[handle]);
+    m_controllers.at(m_currentCtrl)->addGrabs(grabs, ofVec2f(m_copyPasteOffset));
 
     ofLogVerbose() << "Copied to controller #" << m_currentCtrl
                    << " grabs, size=" << m_copyPasteGrabs.size();
@@ -504,6 +1124,9 @@ void ofxLedMapper::keyPressed(ofKeyEventArgs &data)
         case '4':
             // m_grabTypeSelected = LMGrabType::GRAB_CIRCLE;
             break;
+        case '5':
+            m_grabTypeSelected = LMGrabType::GRAB_PATH;
+            break;
         case 'v':
 #ifndef WIN32
             if (data.hasModifier(LM_KEY_CONTROL)) /// don't work on win
@@ -520,6 +1143,20 @@ void ofxLedMapper::keyPressed(ofKeyEventArgs &data)
                 copyGrabs();
             }
             break;
+        case 'z':
+        case 'Z':
+#ifndef WIN32
+            if (data.hasModifier(LM_KEY_CONTROL)) /// don't work on win
+#endif
+            {
+                if (m_currentCtrl >= m_controllers.size())
+                    break;
+                if (data.hasModifier(OF_KEY_SHIFT))
+                    m_controllers.at(m_currentCtrl)->redo();
+                else
+                    m_controllers.at(m_currentCtrl)->undo();
+            }
+            break;
         case OF_KEY_BACKSPACE:
             if (m_currentCtrl < m_controllers.size())
                 m_controllers.at(m_currentCtrl)->deleteSelectedGrabs();
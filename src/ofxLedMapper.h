@@ -24,7 +24,9 @@
 
 #include "Common.h"
 #include "ofMain.h"
+#include "ofxLedConfigSaver.h"
 #include "ofxLedController.h"
+#include "ofxLedPlaylist.h"
 #include "ofxNetwork.h"
 #include "ofxXmlSettings.h"
 
@@ -40,12 +42,44 @@ public:
     void draw();
     void drawGui();
     void send(const ofTexture &);
+    /// merge several sources at LED positions, see ofxLedController::send(layers)
+    void send(const vector<LedSourceLayer> &layers);
+    /// every controller gets source it's bound to, controllers whose source
+    /// is missing in this frame are skipped
+    void send(const LedSources &sources);
+    /// cues for controllers bound to default source, played by send(sources)
+    ofxLedPlaylist &getPlaylist() { return m_playlist; }
+    bool goCue(size_t index);
+    bool nextCue();
+    /// record output of all controllers, default folder is capture in config folder
+    bool startRecording(string folderPath = "");
+    void stopRecording();
+    bool isRecording() const;
+    /// play captures from folder on controllers with recorded file, without sampling
+    /// sources, so it needs no GPU. Default folder is same as for recording
+    bool startPlayback(string folderPath = "", bool loop = true);
+    void stopPlayback();
+    /// time in usec from start of captures
+    void seekPlayback(uint64_t time);
+    bool isPlaying() const;
     bool add(LedOutputType type, string folder_path);
     bool add(unsigned int _ctrlId, LedOutputType type, const string &folder_path);
     bool remove(unsigned int _ctrlId);
+    /// batch layout for controller, see ofxLedController::addGrabs
+    bool addGrabs(unsigned int _ctrlId, const vector<LedGrabDesc> &descs,
+                  bool replaceExisting = false);
+    /// import pixel map into new controllers of type, as many as needed to fit all leds
+    bool importPixelMap(const string &path, LedOutputType type);
     bool load(string folderPath);
+    /// drop all controllers and create them from configs in folder
     bool load();
+    /// apply changes of configs in folder to live controllers, unchanged ones keep streaming
+    bool reload();
+    /// reload when config files change, checked in update every checkInterval msec,
+    /// skipped with warning while controllers have unsaved edits
+    void setAutoReload(bool enable, uint64_t checkInterval = 1000);
     bool save(string folderPath);
+    /// write changed controllers on background thread, see ofxLedConfigSaver
     bool save();
 
     bool checkUniqueId(unsigned int _ctrlId);
@@ -69,13 +103,31 @@ private:
     ofxXmlSettings XML;
     ofDirectory m_dir;
     string m_configFolderPath;
+    ofxLedConfigSaver m_saver;
+    string m_savedFolderPath;
+    set<unsigned int> m_savedIds;
+    bool m_bAutoReload, m_bSavePending;
+    uint64_t m_autoReloadInterval, m_lastConfigCheckTime;
+    map<string, std::filesystem::file_time_type> m_configFilesTimes;
     bool m_bSetup, m_bControlPressed;
     LMGrabType m_grabTypeSelected;
 
+    ofxLedPlaylist m_playlist;
+    ofJson m_savedPlaylist;
+    void loadPlaylist();
+    bool savePlaylist();
+
+    void addController(unique_ptr<ofxLedController> ctrl);
+    void checkConfigFiles();
+    bool readLayoutBin(vector<LedControllerConfig> &configs, vector<uint64_t> &readTimes);
+    void readJsonConfigs(vector<LedControllerConfig> &configs, vector<uint64_t> &readTimes);
+
     void copyGrabs();
     void pasteGrabs();
     void removeGrabs();
-    vector<unique_ptr<ofxLedGrab>> m_copyPasteGrabs;
+    ofxLedGrabPool m_copyPastePool;
+    vector<GrabHandle> m_copyPasteGrabs;
+    float m_copyPasteOffset;
 #ifndef LED_MAPPER_NO_GUI
     // GUI
 
@@ -84,6 +136,11 @@ private:
     unique_ptr<ofxDatGuiTheme> m_guiTheme;
     ofxDatGuiToggle *m_toggleDebugController;
     ofxDatGuiToggle *m_togglePlay;
+    ofxDatGuiToggle *m_toggleRecord;
+    ofxDatGuiToggle *m_togglePlayback;
+    unique_ptr<ofxDatGuiScrollView> m_listPlaylist;
+    ofxDatGuiSlider *m_sliderFadeTime;
+    void updatePlaylistGui();
 #endif
 
 };
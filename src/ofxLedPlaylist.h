@@ -0,0 +1,156 @@
+/*
+ Copyright (C) 2017 Timofey Tavlintsev [http://tvl.io]
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+
+#pragma once
+
+#include "Common.h"
+#include "ofMain.h"
+
+namespace LedMapper {
+
+/// Cue plays named source of ofxLedMapper::send(sources) on controllers bound
+/// to default source, fade time is used when cue starts
+struct LedCue {
+    string name;
+    string source;
+    float fadeTime = 1.f; /// sec
+};
+
+/// Crossfade between sources, progress is weight of "to" at time in usec.
+/// Without "from" source fade starts from what was on LEDs
+struct LedCueFade {
+    string from, to;
+    bool hasFrom = false;
+    uint64_t start = 0, duration = 0;
+
+    float getProgress(uint64_t time) const
+    {
+        if (duration == 0 || time >= start + duration)
+            return 1.f;
+        return time > start ? static_cast<float>(time - start) / duration : 0.f;
+    }
+    bool isFading(uint64_t time) const { return getProgress(time) < 1.f; }
+};
+
+/// Ordered cue list with crossfade timing. Fade runs on time passed by caller,
+/// so it's independent of draw loop rate. Crossfade itself is done by controllers
+/// on sampled LED frames, progress is taken when frame is sampled,
+/// see ofxLedController::send(from, to, fade)
+class ofxLedPlaylist {
+public:
+    void add(LedCue cue) { m_cues.emplace_back(move(cue)); }
+    bool remove(size_t index)
+    {
+        if (index >= m_cues.size())
+            return false;
+        m_cues.erase(m_cues.begin() + index);
+        if (m_current == static_cast<int>(index))
+            m_current = -1;
+        else if (m_current > static_cast<int>(index))
+            --m_current;
+        return true;
+    }
+    void clear()
+    {
+        m_cues.clear();
+        m_current = -1;
+        m_hasFrom = false;
+        m_fadeDuration = 0;
+    }
+    size_t size() const { return m_cues.size(); }
+    const vector<LedCue> &getCues() const { return m_cues; }
+    LedCue *getCue(size_t index) { return index < m_cues.size() ? &m_cues[index] : nullptr; }
+    /// -1 when nothing is playing
+    int getCurrent() const { return m_current; }
+
+    /// start fade from what is on LEDs now to cue at index, time in usec
+    bool go(size_t index, uint64_t time)
+    {
+        if (index >= m_cues.size())
+            return false;
+        /// fade interrupted in the middle continues from the mix that is on LEDs
+        m_hasFrom = m_current >= 0 && !getFade().isFading(time);
+        m_fromSource = m_hasFrom ? m_cues[m_current].source : "";
+        m_current = static_cast<int>(index);
+        m_fadeStart = time;
+        m_fadeDuration = static_cast<uint64_t>(std::max(m_cues[index].fadeTime, 0.f) * 1e6f);
+        return true;
+    }
+    /// loops over the end of list
+    bool next(uint64_t time)
+    {
+        return !m_cues.empty() && go(static_cast<size_t>(m_current + 1) % m_cues.size(), time);
+    }
+    bool prev(uint64_t time)
+    {
+        if (m_cues.empty())
+            return false;
+        return go(m_current > 0 ? m_current - 1 : m_cues.size() - 1, time);
+    }
+
+    /// fade to current cue, finished one when nothing is playing
+    LedCueFade getFade() const
+    {
+        LedCueFade fade;
+        if (m_current < 0)
+            return fade;
+        fade.from = m_fromSource;
+        fade.hasFrom = m_hasFrom;
+        fade.to = m_cues[m_current].source;
+        fade.start = m_fadeStart;
+        fade.duration = m_fadeDuration;
+        return fade;
+    }
+
+    ofJson toJson() const
+    {
+        ofJson cues = ofJson::array();
+        for (const auto &cue : m_cues)
+            cues.push_back({ { "name", cue.name },
+                             { "source", cue.source },
+                             { "fadeTime", cue.fadeTime } });
+        return ofJson{ { "cues", cues } };
+    }
+    void fromJson(const ofJson &j)
+    {
+        clear();
+        if (!j.is_object() || !j.count("cues") || !j.at("cues").is_array())
+            return;
+        for (const auto &item : j.at("cues")) {
+            LedCue cue;
+            cue.name = item.count("name") ? item.at("name").get<string>() : "";
+            cue.source = item.count("source") ? item.at("source").get<string>() : "";
+            cue.fadeTime = item.count("fadeTime") ? item.at("fadeTime").get<float>() : 1.f;
+            m_cues.emplace_back(move(cue));
+        }
+    }
+
+private:
+    vector<LedCue> m_cues;
+    int m_current = -1;
+    string m_fromSource;
+    bool m_hasFrom = false;
+    uint64_t m_fadeStart = 0, m_fadeDuration = 0;
+};
+
+} // namespace LedMapper
@@ -26,6 +26,12 @@ ofxLedArtnet::ofxLedArtnet()
 {
 }
 
+void ofxLedArtnet::release()
+{
+    m_frameConnection.Close();
+    m_bSetup = false;
+}
+
 void ofxLedArtnet::setup(const string ip)
 {
     m_ip = move(ip);
@@ -44,26 +50,36 @@ void ofxLedArtnet::setup(const string ip)
     m_bSetup = true;
 }
 
-void ofxLedArtnet::bindGui(ofxDatGui *gui)
+void ofxLedArtnet::bindGui(ofxDatGui *gui, const function<void()> &onChange)
 {
     auto slider = gui->addSlider(LCGUISliderUniInChan, 1, 6); // up to 1,020 RGB pixels per chan
     slider->setPrecision(0);
-    slider->onSliderEvent([this](ofxDatGuiSliderEvent e) { m_universesInChannel = e.value; });
+    slider->onSliderEvent([this, onChange](ofxDatGuiSliderEvent e) {
+        m_universesInChannel = e.value;
+        onChange();
+    });
 
     gui->addTextInput(LCGUIStartUni, std::to_string(m_startUniverse))
-        ->onTextInputEvent([this](ofxDatGuiTextInputEvent e) {
+        ->onTextInputEvent([this, onChange](ofxDatGuiTextInputEvent e) {
             if (!IsNumber(e.text)) {
                 e.target->setText(std::to_string(m_startUniverse));
                 return;
             }
             m_startUniverse = stoi(e.text);
+            onChange();
         });
 
-    gui->addTextInput(LCGUITextIP, m_ip)->onTextInputEvent([this](ofxDatGuiTextInputEvent e) {
-        if (ValidateIP(e.text)) {
-            setup(e.text);
-        }
-    });
+    gui->addTextInput(LCGUITextIP, m_ip)
+        ->onTextInputEvent([this, onChange](ofxDatGuiTextInputEvent e) {
+            if (!ValidateIP(e.text))
+                return;
+            /// idle output keeps address and connects on setup
+            if (m_bSetup)
+                setup(e.text);
+            else
+                m_ip = e.text;
+            onChange();
+        });
 }
 
 // ref protocols
@@ -127,7 +143,8 @@ void ofxLedArtnet::saveJson(ofJson &config) const
 
 void ofxLedArtnet::loadJson(const ofJson &config)
 {
-    setup(config.contains("ipAddress") ? config.at("ipAddress").get<string>() : s_defaultIp);
+    /// connection is opened by controller on first send, see ofxLedController::activateResources
+    m_ip = config.contains("ipAddress") ? config.at("ipAddress").get<string>() : s_defaultIp;
     m_universesInChannel
         = config.count("universesInChannel") ? config.at("universesInChannel").get<size_t>() : 4;
     m_startUniverse
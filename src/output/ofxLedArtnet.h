@@ -23,10 +23,11 @@ public:
 
     void setup(const string ip);
     void resetup() { setup(m_ip); }
+    void release();
     bool send(ChannelsToPix &&output);
     bool sendUniverse(vector<char> &pixels, size_t offset, size_t universe);
 
-    void bindGui(ofxDatGui *gui);
+    void bindGui(ofxDatGui *gui, const function<void()> &onChange);
 
     vector<string> getChannels() noexcept;
     static size_t getMaxPixelsOut() noexcept;
@@ -19,5 +19,5 @@ public:
     ofxLedDmx(){};
     void setup(const string &serialName);
     void send(const ofPixels &grabbedImg);
-    void bindGui(ofxDatGui *gui);
+    void bindGui(ofxDatGui *gui, const function<void()> &onChange);
 };
@@ -45,6 +45,12 @@ static void LedOutputResetup(LedOutput &output)
     eastl::visit([](auto &out) { out.resetup(); }, output);
 }
 
+/// close sockets, output is set up again with LedOutputResetup
+static void LedOutputRelease(LedOutput &output)
+{
+    eastl::visit([](auto &out) { out.release(); }, output);
+}
+
 static bool LedOutputSend(LedOutput &output, ChannelsToPix pixels)
 {
     bool result = false;
@@ -66,6 +72,19 @@ static size_t LedOutputGetMaxPixels(LedOutput &output)
     return maxPixels;
 }
 
+/// LED IC type selected on output, empty when output doesn't know it
+static string LedOutputGetLedType(const LedOutput &output)
+{
+    string ledType;
+    eastl::visit(
+        [&ledType](const auto &out) {
+            if constexpr (std::is_same<std::decay_t<decltype(out)>, ofxLedRpi>::value)
+                ledType = out.getLedType();
+        },
+        output);
+    return ledType;
+}
+
 static void LedOutputSave(LedOutput &output, ofJson &config)
 {
     eastl::visit([&config](auto &out) { out.saveJson(config); }, output);
@@ -79,9 +98,10 @@ static void LedOutputLoad(LedOutput &output, const ofJson &config)
 #ifndef LED_MAPPER_NO_GUI
 /// Static function to generate universal container for controllers GUI
 
-static void LedOutputBindGui(LedOutput &output, ofxDatGui *gui)
+/// onChange is called after gui changes output settings
+static void LedOutputBindGui(LedOutput &output, ofxDatGui *gui, const function<void()> &onChange)
 {
-    eastl::visit([&gui](auto &out) { out.bindGui(gui); }, output);
+    eastl::visit([&](auto &out) { out.bindGui(gui, onChange); }, output);
 }
 
 static unique_ptr<ofxDatGui> GenerateOutputGui()
@@ -15,7 +15,8 @@ public:
     virtual bool resetup();
     virtual bool send(ChannelsToPix &&output);
 
-    virtual void bindGui(ofxDatGui *gui);
+    /// onChange is called after gui changes settings
+    virtual void bindGui(ofxDatGui *gui, const function<void()> &onChange);
 
     virtual vector<string> getChannels() noexcept;
     virtual size_t getMaxPixelsOut() noexcept;
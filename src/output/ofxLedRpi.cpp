@@ -35,6 +35,13 @@ bool ofxLedRpi::resetup()
     return false; /// for ternary operator in send
 }
 
+void ofxLedRpi::release()
+{
+    m_frameConnection.Close();
+    m_confConnection.Close();
+    m_bSetup = false;
+}
+
 void ofxLedRpi::setup(const string ip, int port)
 {
     m_ip = move(ip);
@@ -61,19 +68,27 @@ void ofxLedRpi::setup(const string ip, int port)
     sendLedType(m_currentLedType);
 }
 
-void ofxLedRpi::bindGui(ofxDatGui *gui)
+void ofxLedRpi::bindGui(ofxDatGui *gui, const function<void()> &onChange)
 {
     auto dropdown = gui->addDropdown(LCGUIDropLedType, s_ledTypeList);
     dropdown->select(find(s_ledTypeList.begin(), s_ledTypeList.end(), m_currentLedType)
                      - s_ledTypeList.begin());
-    dropdown->onDropdownEvent(
-        [this](ofxDatGuiDropdownEvent e) { this->sendLedType(s_ledTypeList[e.child]); });
-
-    gui->addTextInput(LCGUITextIP, m_ip)->onTextInputEvent([this](ofxDatGuiTextInputEvent e) {
-        if (ValidateIP(e.text)) {
-            this->setup(e.text, m_port);
-        }
+    dropdown->onDropdownEvent([this, onChange](ofxDatGuiDropdownEvent e) {
+        this->sendLedType(s_ledTypeList[e.child]);
+        onChange();
     });
+
+    gui->addTextInput(LCGUITextIP, m_ip)
+        ->onTextInputEvent([this, onChange](ofxDatGuiTextInputEvent e) {
+            if (!ValidateIP(e.text))
+                return;
+            /// idle output keeps address and connects on setup
+            if (m_bSetup)
+                this->setup(e.text, m_port);
+            else
+                m_ip = e.text;
+            onChange();
+        });
 }
 
 bool ofxLedRpi::send(ChannelsToPix &&output)
@@ -108,14 +123,15 @@ bool ofxLedRpi::send(ChannelsToPix &&output)
 
 void ofxLedRpi::sendLedType(const string &ledType)
 {
-    if (!m_bSetup)
+    if (find(s_ledTypeList.begin(), s_ledTypeList.end(), ledType) == s_ledTypeList.end())
         return;
 
-    if (find(s_ledTypeList.begin(), s_ledTypeList.end(), ledType) == s_ledTypeList.end())
+    /// idle output keeps type and sends it on setup
+    m_currentLedType = ledType;
+    if (!m_bSetup)
         return;
 
     ofLogVerbose() << "Update LedType with " << ledType;
-    m_currentLedType = ledType;
     /// send type 5 times hoping UDP packet won't lost
     for (size_t i = 0; i < 5; ++i)
         m_confConnection.Send(m_currentLedType.c_str(), m_currentLedType.size());
@@ -133,8 +149,9 @@ void ofxLedRpi::loadJson(const ofJson &config)
     m_currentLedType
         = config.count("ledType") ? config.at("ledType").get<string>() : s_ledTypeList.front();
 
-    setup(config.count("ipAddress") ? config.at("ipAddress").get<string>() : RPI_IP,
-          config.count("port") ? config.at("port").get<int>() : RPI_PORT);
+    /// connection is opened by controller on first send, see ofxLedController::activateResources
+    m_ip = config.count("ipAddress") ? config.at("ipAddress").get<string>() : RPI_IP;
+    m_port = config.count("port") ? config.at("port").get<int>() : RPI_PORT;
 }
 
 } // namespace LedMapper
\ No newline at end of file
@@ -44,7 +44,8 @@ public:
     ~ofxLedRpi();
     void setup(const string ip, const int port = RPI_PORT);
     bool resetup();
-    void bindGui(ofxDatGui *gui);
+    void release();
+    void bindGui(ofxDatGui *gui, const function<void()> &onChange);
 
     bool send(ChannelsToPix &&output);
     void sendLedType(const string &ledType);
@@ -0,0 +1,152 @@
+/*
+ Copyright (C) 2017 Timofey Tavlintsev [http://tvl.io]
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+
+#pragma once
+
+#include "Common.h"
+#include "ofMain.h"
+
+namespace LedMapper {
+
+/// Color correction of sampled LEDs before they are sent:
+/// out = 255 * (in / 255) ^ gamma * brightness * whiteBalance[channel].
+/// Set per controller, grab can override it for its LEDs
+struct LedColorCorrection {
+    float gamma = 1.f;
+    float brightness = 1.f;
+    /// r, g, b gains
+    std::array<float, 3> whiteBalance = { { 1.f, 1.f, 1.f } };
+
+    bool isIdentity() const
+    {
+        return gamma == 1.f && brightness == 1.f && whiteBalance[0] == 1.f
+               && whiteBalance[1] == 1.f && whiteBalance[2] == 1.f;
+    }
+    bool operator==(const LedColorCorrection &rhs) const
+    {
+        return gamma == rhs.gamma && brightness == rhs.brightness
+               && whiteBalance == rhs.whiteBalance;
+    }
+    bool operator!=(const LedColorCorrection &rhs) const { return !(*this == rhs); }
+
+    ofJson toJson() const
+    {
+        return ofJson{ { "gamma", gamma },
+                       { "brightness", brightness },
+                       { "whiteBalance", { whiteBalance[0], whiteBalance[1], whiteBalance[2] } } };
+    }
+    /// missing or wrongly typed keys get identity values
+    void fromJson(const ofJson &j)
+    {
+        *this = LedColorCorrection();
+        if (!j.is_object())
+            return;
+        if (j.count("gamma") && j.at("gamma").is_number())
+            gamma = j.at("gamma").get<float>();
+        if (j.count("brightness") && j.at("brightness").is_number())
+            brightness = j.at("brightness").get<float>();
+        if (j.count("whiteBalance") && j.at("whiteBalance").is_array()
+            && j.at("whiteBalance").size() == 3) {
+            for (size_t i = 0; i < 3; ++i)
+                if (j.at("whiteBalance").at(i).is_number())
+                    whiteBalance[i] = j.at("whiteBalance").at(i).get<float>();
+        }
+    }
+};
+
+/// Lookup tables for every output byte of LED, built once for correction and color order,
+/// applying them is one table read per byte. Second set keeps 8.8 fixed point result
+/// for temporal dithering, see ofxLedDither
+class ofxLedColorLut {
+public:
+    ofxLedColorLut()
+        : m_bIdentity(true)
+    {
+        for (size_t byte = 0; byte < 3; ++byte) {
+            for (int i = 0; i < 256; ++i) {
+                m_tables[byte][i] = i;
+                m_tables16[byte][i] = i << 8;
+            }
+        }
+    }
+
+    ofxLedColorLut(const LedColorCorrection &correction, GRAB_COLOR_TYPE colorType)
+        : m_bIdentity(correction.isIdentity())
+    {
+        const auto order = GetColorOrder(colorType);
+        const float gamma = std::max(correction.gamma, 0.01f);
+        for (size_t byte = 0; byte < 3; ++byte) {
+            float gain = 255.f * correction.brightness * correction.whiteBalance[order[byte]];
+            for (int i = 0; i < 256; ++i) {
+                float value = std::pow(i / 255.f, gamma) * gain;
+                m_tables[byte][i] = static_cast<uint8_t>(ofClamp(value + .5f, 0.f, 255.f));
+                m_tables16[byte][i]
+                    = static_cast<uint16_t>(ofClamp(value * 256.f + .5f, 0.f, 255.f * 256.f));
+            }
+        }
+    }
+
+    bool isIdentity() const { return m_bIdentity; }
+
+    /// leds are packed by 3 bytes in output color order
+    void apply(char *leds, size_t numLeds) const
+    {
+        if (m_bIdentity)
+            return;
+        auto *data = reinterpret_cast<uint8_t *>(leds);
+        const auto &t0 = m_tables[0], &t1 = m_tables[1], &t2 = m_tables[2];
+        for (size_t i = 0; i < numLeds; ++i, data += 3) {
+            data[0] = t0[data[0]];
+            data[1] = t1[data[1]];
+            data[2] = t2[data[2]];
+        }
+    }
+
+    /// same as apply but adds fraction left from previous frames and stores new one,
+    /// errors are per output byte arrays of numLeds
+    void apply(char *leds, size_t numLeds, const std::array<uint8_t *, 3> &errors) const
+    {
+        if (m_bIdentity)
+            return;
+        auto *data = reinterpret_cast<uint8_t *>(leds);
+        for (size_t byte = 0; byte < 3; ++byte) {
+            const auto &table = m_tables16[byte];
+            uint8_t *error = errors[byte];
+            uint8_t *out = data + byte;
+            for (size_t i = 0; i < numLeds; ++i) {
+                uint32_t value = table[out[i * 3]] + error[i];
+                out[i * 3] = static_cast<uint8_t>(value >> 8);
+                error[i] = static_cast<uint8_t>(value);
+            }
+        }
+    }
+
+private:
+    std::array<std::array<uint8_t, 256>, 3> m_tables;
+    std::array<std::array<uint16_t, 256>, 3> m_tables16;
+    bool m_bIdentity;
+};
+
+using LedColorLutPtr = shared_ptr<const ofxLedColorLut>;
+
+} // namespace LedMapper
@@ -0,0 +1,85 @@
+/*
+ Copyright (C) 2017 Timofey Tavlintsev [http://tvl.io]
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+
+#pragma once
+
+#include "Common.h"
+#include "ofMain.h"
+
+namespace LedMapper {
+
+/// How layer is merged onto layers below it:
+/// HTP - highest value of every byte, LTP - layer replaces lit LEDs, black LEDs show below,
+/// ALPHA - crossfade by layer opacity, ADD - saturated sum.
+/// Layer values are scaled by opacity in every mode
+enum LedMergeMode { LED_MERGE_HTP, LED_MERGE_LTP, LED_MERGE_ALPHA, LED_MERGE_ADD };
+static const vector<string> s_mergeModes = { "HTP", "LTP", "Alpha", "Add" };
+
+/// Input of multi source send, texture is sampled on GPU, pixels on CPU.
+/// First layer is base, next ones are merged on top in order
+struct LedSourceLayer {
+    const ofTexture *texture = nullptr;
+    const ofPixels *pixels = nullptr;
+    float opacity = 1.f;
+};
+
+/// Named sources of one frame, every source is stack of layers.
+/// Controller samples source it's bound to, see ofxLedController::setSource
+using LedSources = map<string, vector<LedSourceLayer>>;
+
+/// Merge sampled layer onto base in place, only LEDs present in both are touched
+static void CompositeLayer(ChannelsToPix &base, const ChannelsToPix &layer, LedMergeMode mode,
+                           float opacity)
+{
+    const uint32_t alpha = static_cast<uint32_t>(ofClamp(opacity, 0.f, 1.f) * 256.f);
+    for (size_t chan = 0; chan < base.size() && chan < layer.size(); ++chan) {
+        auto *dst = reinterpret_cast<uint8_t *>(base[chan].data());
+        const auto *src = reinterpret_cast<const uint8_t *>(layer[chan].data());
+        const size_t size = std::min(base[chan].size(), layer[chan].size()) / 3 * 3;
+        switch (mode) {
+            case LED_MERGE_HTP:
+                for (size_t i = 0; i < size; ++i)
+                    dst[i] = std::max<uint32_t>(dst[i], (src[i] * alpha) >> 8);
+                break;
+            case LED_MERGE_LTP:
+                for (size_t i = 0; i < size; i += 3) {
+                    if ((src[i] | src[i + 1] | src[i + 2]) == 0)
+                        continue;
+                    dst[i] = (src[i] * alpha) >> 8;
+                    dst[i + 1] = (src[i + 1] * alpha) >> 8;
+                    dst[i + 2] = (src[i + 2] * alpha) >> 8;
+                }
+                break;
+            case LED_MERGE_ALPHA:
+                for (size_t i = 0; i < size; ++i)
+                    dst[i] = (dst[i] * (256 - alpha) + src[i] * alpha) >> 8;
+                break;
+            case LED_MERGE_ADD:
+                for (size_t i = 0; i < size; ++i)
+                    dst[i] = std::min<uint32_t>(dst[i] + ((src[i] * alpha) >> 8), 255);
+                break;
+        }
+    }
+}
+
+} // namespace LedMapper
@@ -0,0 +1,56 @@
+/*
+ Copyright (C) 2017 Timofey Tavlintsev [http://tvl.io]
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+
+#pragma once
+
+#include "process/ofxLedColorCorrection.h"
+
+namespace LedMapper {
+
+/// Temporal dithering of corrected LEDs: fraction that 8 bit output drops is kept per LED
+/// and added to the next frame, so dim levels between two steps average out over frames.
+/// Errors are stored per output byte in separate arrays
+class ofxLedDither {
+public:
+    /// errors are kept while number of LEDs stays the same
+    void resize(size_t numLeds)
+    {
+        if (numLeds == size())
+            return;
+        for (auto &error : m_errors)
+            error.assign(numLeds, 0);
+    }
+    size_t size() const { return m_errors[0].size(); }
+
+    /// errors of LEDs starting from firstLed in wiring order
+    std::array<uint8_t *, 3> getErrors(size_t firstLed)
+    {
+        return { { m_errors[0].data() + firstLed, m_errors[1].data() + firstLed,
+                   m_errors[2].data() + firstLed } };
+    }
+
+private:
+    std::array<vector<uint8_t>, 3> m_errors;
+};
+
+} // namespace LedMapper
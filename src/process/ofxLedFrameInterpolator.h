@@ -0,0 +1,151 @@
+/*
+ Copyright (C) 2017 Timofey Tavlintsev [http://tvl.io]
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+
+#pragma once
+
+#include "ofxLedLayout.h"
+#include <mutex>
+
+namespace LedMapper {
+
+enum LedInterpolation { LED_INTERPOLATION_OFF, LED_INTERPOLATION_LINEAR, LED_INTERPOLATION_GAMMA };
+static const vector<string> s_interpolationTypes = { "Off", "Linear", "Gamma" };
+
+/// Keeps last two sampled frames and blends them for output that runs at own rate.
+/// Output is one source interval behind, so it always blends between frames it already has.
+/// Gamma mode blends in linear light, so fades don't dip in the middle.
+/// push and sample may be called from different threads
+class ofxLedFrameInterpolator {
+public:
+    ofxLedFrameInterpolator()
+        : m_mode(LED_INTERPOLATION_LINEAR)
+    {
+        for (int i = 0; i < 256; ++i)
+            m_decode[i] = static_cast<uint16_t>(std::pow(i / 255.f, s_gamma) * s_linearMax + .5f);
+        for (int i = 0; i <= s_linearMax; ++i)
+            m_encode[i] = static_cast<uint8_t>(
+                std::pow(i / static_cast<float>(s_linearMax), 1.f / s_gamma) * 255.f + .5f);
+    }
+
+    void setMode(LedInterpolation mode)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_mode = mode;
+    }
+
+    /// time in usec, layout is the snapshot frame was sampled with
+    void push(ChannelsToPix &&pixels, LedLayoutPtr layout, uint64_t time)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_prev = move(m_next);
+        m_next = { move(pixels), move(layout), time };
+    }
+
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_prev = Frame();
+        m_next = Frame();
+    }
+
+    /// frame for output at time, returns false until first frame is pushed
+    bool sample(uint64_t time, ChannelsToPix &pixels, LedLayoutPtr &layout)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_next.layout == nullptr)
+            return false;
+
+        layout = m_next.layout;
+        if (m_prev.layout == nullptr || m_next.time <= m_prev.time
+            || !isSameSize(m_prev.pixels, m_next.pixels)) {
+            pixels = m_next.pixels;
+            return true;
+        }
+
+        uint64_t interval = m_next.time - m_prev.time;
+        uint64_t elapsed = time > m_next.time ? std::min(time - m_next.time, interval) : 0;
+        /// weight of next frame in 1/256
+        uint32_t weight = static_cast<uint32_t>(elapsed * 256 / interval);
+        if (weight == 0 || weight == 256) {
+            pixels = weight == 0 ? m_prev.pixels : m_next.pixels;
+            return true;
+        }
+
+        pixels.resize(m_next.pixels.size());
+        for (size_t chan = 0; chan < pixels.size(); ++chan) {
+            const auto *from = reinterpret_cast<const uint8_t *>(m_prev.pixels[chan].data());
+            const auto *to = reinterpret_cast<const uint8_t *>(m_next.pixels[chan].data());
+            auto &out = pixels[chan];
+            out.resize(m_next.pixels[chan].size());
+            auto *dst = reinterpret_cast<uint8_t *>(out.data());
+            if (m_mode == LED_INTERPOLATION_GAMMA)
+                blendGamma(from, to, dst, out.size(), weight);
+            else
+                blendLinear(from, to, dst, out.size(), weight);
+        }
+        return true;
+    }
+
+private:
+    static constexpr float s_gamma = 2.2f;
+    static constexpr int s_linearMax = 4095;
+
+    struct Frame {
+        ChannelsToPix pixels;
+        LedLayoutPtr layout;
+        uint64_t time = 0;
+    };
+
+    static bool isSameSize(const ChannelsToPix &lhs, const ChannelsToPix &rhs)
+    {
+        if (lhs.size() != rhs.size())
+            return false;
+        for (size_t i = 0; i < lhs.size(); ++i)
+            if (lhs[i].size() != rhs[i].size())
+                return false;
+        return true;
+    }
+
+    static void blendLinear(const uint8_t *from, const uint8_t *to, uint8_t *out, size_t size,
+                            uint32_t weight)
+    {
+        for (size_t i = 0; i < size; ++i)
+            out[i] = (from[i] * (256 - weight) + to[i] * weight + 128) >> 8;
+    }
+
+    void blendGamma(const uint8_t *from, const uint8_t *to, uint8_t *out, size_t size,
+                    uint32_t weight) const
+    {
+        for (size_t i = 0; i < size; ++i)
+            out[i] = m_encode[(m_decode[from[i]] * (256 - weight) + m_decode[to[i]] * weight
+                               + 128) >> 8];
+    }
+
+    std::mutex m_mutex;
+    LedInterpolation m_mode;
+    Frame m_prev, m_next;
+    std::array<uint16_t, 256> m_decode;
+    std::array<uint8_t, s_linearMax + 1> m_encode;
+};
+
+} // namespace LedMapper
@@ -0,0 +1,159 @@
+/*
+ Copyright (C) 2017 Timofey Tavlintsev [http://tvl.io]
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+
+#pragma once
+
+#include "Common.h"
+#include "ofMain.h"
+#include <atomic>
+
+namespace LedMapper {
+
+/// Current draw of one LED: idle current plus current of every color byte at 255
+struct LedCurrentModel {
+    float idleAmps;
+    float colorAmps;
+};
+
+/// rough datasheet numbers, unknown types are counted as WS281X
+static LedCurrentModel GetLedCurrentModel(const string &ledType)
+{
+    if (ledType == "SK9822")
+        return { 0.001f, 0.018f };
+    return { 0.001f, 0.02f };
+}
+
+/// Estimated draw and applied scale of last sent frame
+struct LedPowerTelemetry {
+    /// before limiting
+    vector<float> channelAmps;
+    /// 1 when channel is under budget, controller scale is already included
+    vector<float> channelScales;
+    float totalAmps = 0.f;
+    float controllerScale = 1.f;
+};
+
+using LedPowerTelemetryPtr = shared_ptr<const LedPowerTelemetry>;
+
+/// Scales down output bytes of channels that would draw more than their budget,
+/// then all channels when controller total is over its budget. Budgets in amps, 0 is no limit.
+/// Estimate is linear in byte values, so scaling by budget / draw lands on budget
+class ofxLedPowerLimiter {
+public:
+    ofxLedPowerLimiter()
+        : m_channelBudget(0.f)
+        , m_controllerBudget(0.f)
+        , m_telemetry(make_shared<LedPowerTelemetry>())
+    {
+    }
+
+    void setChannelBudget(float amps) { m_channelBudget = std::max(amps, 0.f); }
+    float getChannelBudget() const { return m_channelBudget; }
+    void setControllerBudget(float amps) { m_controllerBudget = std::max(amps, 0.f); }
+    float getControllerBudget() const { return m_controllerBudget; }
+    bool isEnabled() const { return m_channelBudget > 0.f || m_controllerBudget > 0.f; }
+
+    ofJson toJson() const
+    {
+        return ofJson{ { "channelAmps", getChannelBudget() },
+                       { "controllerAmps", getControllerBudget() } };
+    }
+    void fromJson(const ofJson &j)
+    {
+        auto read = [&j](const char *key) {
+            return j.is_object() && j.count(key) && j.at(key).is_number() ? j.at(key).get<float>()
+                                                                          : 0.f;
+        };
+        setChannelBudget(read("channelAmps"));
+        setControllerBudget(read("controllerAmps"));
+    }
+
+    /// telemetry of last applied frame, safe to read from any thread
+    LedPowerTelemetryPtr peekTelemetry() const { return std::atomic_load(&m_telemetry); }
+
+    void apply(ChannelsToPix &pixels, const LedCurrentModel &model)
+    {
+        auto telemetry = make_shared<LedPowerTelemetry>();
+        telemetry->channelAmps.resize(pixels.size());
+        telemetry->channelScales.assign(pixels.size(), 1.f);
+
+        const float channelBudget = m_channelBudget;
+        const float controllerBudget = m_controllerBudget;
+        float limitedAmps = 0.f;
+        for (size_t chan = 0; chan < pixels.size(); ++chan) {
+            const auto &data = pixels[chan];
+            float idleAmps = data.size() / 3 * model.idleAmps;
+            float colorAmps = sumBytes(data) / 255.f * model.colorAmps;
+            float amps = idleAmps + colorAmps;
+            telemetry->channelAmps[chan] = amps;
+            telemetry->totalAmps += amps;
+
+            float &scale = telemetry->channelScales[chan];
+            if (channelBudget > 0.f && amps > channelBudget && colorAmps > 0.f)
+                scale = std::max(channelBudget - idleAmps, 0.f) / colorAmps;
+            limitedAmps += idleAmps + colorAmps * scale;
+        }
+
+        if (controllerBudget > 0.f && limitedAmps > controllerBudget) {
+            float idleAmps = 0.f;
+            for (const auto &data : pixels)
+                idleAmps += data.size() / 3 * model.idleAmps;
+            float colorAmps = limitedAmps - idleAmps;
+            if (colorAmps > 0.f)
+                telemetry->controllerScale
+                    = std::max(controllerBudget - idleAmps, 0.f) / colorAmps;
+            for (auto &scale : telemetry->channelScales)
+                scale *= telemetry->controllerScale;
+        }
+
+        for (size_t chan = 0; chan < pixels.size(); ++chan)
+            if (telemetry->channelScales[chan] < 1.f)
+                scaleBytes(pixels[chan], telemetry->channelScales[chan]);
+
+        std::atomic_store(&m_telemetry, LedPowerTelemetryPtr(move(telemetry)));
+    }
+
+private:
+    static uint64_t sumBytes(const vector<char> &data)
+    {
+        const auto *bytes = reinterpret_cast<const uint8_t *>(data.data());
+        uint64_t sum = 0;
+        for (size_t i = 0; i < data.size(); ++i)
+            sum += bytes[i];
+        return sum;
+    }
+
+    static void scaleBytes(vector<char> &data, float scale)
+    {
+        /// factor rounded down, so channel never ends over budget
+        const uint32_t factor = static_cast<uint32_t>(scale * 65536.f);
+        auto *bytes = reinterpret_cast<uint8_t *>(data.data());
+        for (size_t i = 0; i < data.size(); ++i)
+            bytes[i] = (bytes[i] * factor) >> 16;
+    }
+
+    std::atomic<float> m_channelBudget, m_controllerBudget;
+    LedPowerTelemetryPtr m_telemetry;
+};
+
+} // namespace LedMapper
@@ -0,0 +1,150 @@
+/*
+ Copyright (C) 2017 Timofey Tavlintsev [http://tvl.io]
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in all
+ copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ SOFTWARE.
+ */
+
+
+#pragma once
+
+#include "ofxLedLayout.h"
+#include <atomic>
+
+namespace LedMapper {
+
+enum LedSmoothingType { LED_SMOOTHING_OFF, LED_SMOOTHING_EMA, LED_SMOOTHING_SLEW };
+static const vector<string> s_smoothingTypes = { "Off", "Average", "Slew" };
+
+/// Temporal filter of sampled LEDs against flicker of noisy sources.
+/// Average: exponential moving average with time constant in msec,
+/// Slew: value changes by at most slew rate levels per second.
+/// State is 8.8 fixed point per LED, one array per output byte, and follows elapsed time,
+/// so result doesn't depend on frame rate. Settings may change from other thread than apply
+class ofxLedSmoothing {
+public:
+    ofxLedSmoothing()
+        : m_type(LED_SMOOTHING_OFF)
+        , m_timeConstant(100.f)
+        , m_slewRate(1000.f)
+        , m_lastTime(0)
+    {
+    }
+
+    void setType(LedSmoothingType type) { m_type = type; }
+    LedSmoothingType getType() const { return m_type; }
+    void setTimeConstant(float msec) { m_timeConstant = std::max(msec, 0.f); }
+    float getTimeConstant() const { return m_timeConstant; }
+    void setSlewRate(float levelsPerSec) { m_slewRate = std::max(levelsPerSec, 0.f); }
+    float getSlewRate() const { return m_slewRate; }
+
+    ofJson toJson() const
+    {
+        return ofJson{ { "type", getType() },
+                       { "timeConstant", getTimeConstant() },
+                       { "slewRate", getSlewRate() } };
+    }
+    void fromJson(const ofJson &j)
+    {
+        auto read = [&j](const char *key, float def) {
+            return j.is_object() && j.count(key) && j.at(key).is_number() ? j.at(key).get<float>()
+                                                                          : def;
+        };
+        setType(static_cast<LedSmoothingType>(static_cast<int>(read("type", 0))));
+        setTimeConstant(read("timeConstant", 100.f));
+        setSlewRate(read("slewRate", 1000.f));
+    }
+
+    /// filter pixels in place, time in usec. State restarts from current frame
+    /// when number of LEDs changes or filter was off
+    void apply(const LedLayout &layout, ChannelsToPix &pixels, uint64_t time)
+    {
+        const auto type = getType();
+        if (type == LED_SMOOTHING_OFF) {
+            m_lastTime = 0;
+            return;
+        }
+
+        bool restart = m_lastTime == 0 || m_state[0].size() != layout.totalLeds;
+        const float dt = restart ? 0.f : (time - m_lastTime) / 1000.f;
+        m_lastTime = std::max<uint64_t>(time, 1);
+        if (restart) {
+            for (auto &state : m_state)
+                state.assign(layout.totalLeds, 0);
+        }
+
+        /// EMA weight of new value and slew step, both in fixed point
+        const float timeConstant = getTimeConstant();
+        uint32_t weight = 65536;
+        if (timeConstant > 0.f)
+            weight = static_cast<uint32_t>((1.f - std::exp(-dt / timeConstant)) * 65536);
+        const int32_t step = static_cast<int32_t>(
+            std::min(getSlewRate() * dt / 1000.f * 256.f, 65535.f));
+
+        size_t chanBegin = 0;
+        for (size_t chan = 0; chan < pixels.size() && chan < layout.channelsTotalLeds.size();
+             ++chan) {
+            auto *data = reinterpret_cast<uint8_t *>(pixels[chan].data());
+            size_t numLeds
+                = std::min<size_t>(pixels[chan].size() / 3, layout.channelsTotalLeds[chan]);
+            for (size_t byte = 0; byte < 3; ++byte) {
+                uint16_t *state = m_state[byte].data() + chanBegin;
+                uint8_t *out = data + byte;
+                if (restart)
+                    seed(out, state, numLeds);
+                else if (type == LED_SMOOTHING_EMA)
+                    average(out, state, numLeds, weight);
+                else
+                    slew(out, state, numLeds, step);
+            }
+            chanBegin += layout.channelsTotalLeds[chan];
+        }
+    }
+
+private:
+    static void seed(uint8_t *out, uint16_t *state, size_t numLeds)
+    {
+        for (size_t i = 0; i < numLeds; ++i)
+            state[i] = out[i * 3] << 8;
+    }
+
+    static void average(uint8_t *out, uint16_t *state, size_t numLeds, uint32_t weight)
+    {
+        for (size_t i = 0; i < numLeds; ++i) {
+            int32_t delta = (out[i * 3] << 8) - state[i];
+            state[i] += static_cast<int32_t>((static_cast<int64_t>(delta) * weight) >> 16);
+            out[i * 3] = (state[i] + 128) >> 8;
+        }
+    }
+
+    static void slew(uint8_t *out, uint16_t *state, size_t numLeds, int32_t step)
+    {
+        for (size_t i = 0; i < numLeds; ++i) {
+            int32_t delta = (out[i * 3] << 8) - state[i];
+            state[i] += std::min(std::max(delta, -step), step);
+            out[i * 3] = (state[i] + 128) >> 8;
+        }
+    }
+
+    std::atomic<LedSmoothingType> m_type;
+    std::atomic<float> m_timeConstant, m_slewRate;
+    uint64_t m_lastTime;
+    std::array<vector<uint16_t>, 3> m_state;
+};
+
+} // namespace LedMapper